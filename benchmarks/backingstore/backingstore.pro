@@ -0,0 +1,14 @@
+# Standalone benchmark, not part of the plugin build. Runs the "meego"
+# platform plugin against private Xvfb servers, see main.cpp.
+TEMPLATE = app
+TARGET = backingstore_benchmark
+
+CONFIG += console
+CONFIG -= app_bundle
+
+QT += gui
+
+DEFINES += QT_NO_FOREACH
+
+SOURCES = \
+        main.cpp
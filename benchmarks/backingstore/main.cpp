@@ -0,0 +1,450 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+/*
+    Measures what QXcbBackingStore flushes cost on its different upload paths.
+
+    Without --run, starts a private Xvfb for every depth and runs itself
+    against it for every paint pattern, with and without MIT-SHM, printing
+    one line per run with the upload path and image depth, the frames per
+    second, and the requests, bytes on the wire and stalls per flush the
+    plugin reports in the qt.qpa.xcb.backingstore logging category.
+
+    The patterns are full frames, many small rects, scrolling up with the
+    revealed rows painted, and full frames of a translucent window. With
+    --present the flushes go through X Present, and --verify checks that the
+    server shows a last frame painted in a known color.
+
+    The plugin is loaded as the "meego" platform, so QT_PLUGIN_PATH has to
+    point at it unless it is installed.
+
+    Xvfb always uses the image byte order of the host. To exercise the byte
+    swapping upload, pass --display to run against a server of the other
+    byte order instead.
+*/
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QLoggingCategory>
+#include <QtCore/QProcess>
+#include <QtCore/QRandomGenerator>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QThread>
+#include <QtGui/QBackingStore>
+#include <QtGui/QGuiApplication>
+#include <QtGui/QPainter>
+#include <QtGui/QScreen>
+#include <QtGui/QWindow>
+
+#include <stdio.h>
+
+enum Pattern {
+    FullFrame,
+    SmallRects,
+    ScrollReveal,
+    Alpha
+};
+
+static const char *const patternNames[] = { "full", "rects", "scroll", "alpha" };
+
+static bool patternFromName(const QString &name, Pattern *pattern)
+{
+    for (int i = 0; i < int(sizeof(patternNames) / sizeof(patternNames[0])); ++i) {
+        if (name == QLatin1String(patternNames[i])) {
+            *pattern = Pattern(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// What the backing store reported, summed up over its reports
+struct Totals {
+    QString path;
+    qint64 flushes = 0;
+    double requests = 0;
+    double bytes = 0;
+    qint64 stalls = 0;
+    qint64 stallTimeUs = 0;
+};
+
+static Totals totals;
+static bool verbose = false;
+
+static void messageHandler(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+    if (qstrcmp(context.category, "qt.qpa.xcb.backingstore") != 0) {
+        if (type != QtDebugMsg || verbose)
+            fprintf(stderr, "%s\n", qPrintable(message));
+        return;
+    }
+
+    if (verbose)
+        fprintf(stderr, "%s\n", qPrintable(message));
+
+    static const QRegularExpression report(QStringLiteral(
+            "\\]\\s+(.+?)\\s+depth\\s+(\\d+)\\s+:\\s+(\\d+)\\s+flushes,.*per second,"
+            "\\s+(\\S+)\\s+requests and\\s+(\\d+)\\s+bytes per flush,"
+            "\\s+(\\d+)\\s+stalls taking\\s+(\\d+)\\s+us"));
+    const QRegularExpressionMatch match = report.match(message);
+    if (!match.hasMatch())
+        return;
+
+    const qint64 flushes = match.captured(3).toLongLong();
+    totals.path = match.captured(1) + QLatin1Char('/') + match.captured(2);
+    totals.flushes += flushes;
+    totals.requests += match.captured(4).toDouble() * flushes;
+    totals.bytes += match.captured(5).toDouble() * flushes;
+    totals.stalls += match.captured(6).toLongLong();
+    totals.stallTimeUs += match.captured(7).toLongLong();
+}
+
+static QRegion paintFrame(QBackingStore *store, Pattern pattern, int frame, QRandomGenerator *random)
+{
+    const QRect bounds(QPoint(), store->size());
+    const QColor color = QColor::fromHsv(frame * 7 % 360, 255, 255, pattern == Alpha ? 160 : 255);
+
+    QRegion region;
+    switch (pattern) {
+    case FullFrame:
+    case Alpha:
+        region = bounds;
+        break;
+    case SmallRects:
+        for (int i = 0; i < 64; ++i) {
+            region |= QRect(random->bounded(bounds.width() - 16),
+                            random->bounded(bounds.height() - 16), 16, 16);
+        }
+        break;
+    case ScrollReveal: {
+        const int step = 8;
+        if (store->scroll(bounds, 0, -step))
+            region = QRect(0, bounds.height() - step, bounds.width(), step);
+        else
+            region = bounds;
+        break;
+    }
+    }
+
+    store->beginPaint(region);
+    QPainter painter(store->paintDevice());
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    for (const QRect &rect : region)
+        painter.fillRect(rect, color);
+    painter.end();
+    store->endPaint();
+
+    return region;
+}
+
+// Counts the pixels of the window on the server that aren't \a color
+static int verifyWindow(QWindow *window, const QColor &color)
+{
+    const QImage grabbed = window->screen()->grabWindow(window->winId())
+            .toImage().convertToFormat(QImage::Format_RGB32);
+    const QRgb expected = color.rgb();
+
+    int mismatches = 0;
+    for (int y = 0; y < grabbed.height(); ++y) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(grabbed.constScanLine(y));
+        for (int x = 0; x < grabbed.width(); ++x) {
+            if ((line[x] & 0xffffff) != (expected & 0xffffff))
+                ++mismatches;
+        }
+    }
+    return grabbed.isNull() ? -1 : mismatches;
+}
+
+// Processes events until \a done returns true, or \a ms have passed
+template <typename Predicate>
+static bool waitFor(Predicate done, int ms)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!done()) {
+        if (timer.hasExpired(ms))
+            return false;
+        QCoreApplication::processEvents();
+        QThread::msleep(5);
+    }
+    return true;
+}
+
+static int runPattern(Pattern pattern, const QSize &size, int frames, bool verify)
+{
+    QWindow window;
+    window.setSurfaceType(QSurface::RasterSurface);
+    if (pattern == Alpha) {
+        QSurfaceFormat format;
+        format.setAlphaBufferSize(8);
+        window.setFormat(format);
+    }
+    window.resize(size);
+    window.show();
+
+    if (!waitFor([&window]() { return window.isExposed(); }, 5000)) {
+        fprintf(stderr, "window did not get exposed\n");
+        return 1;
+    }
+
+    QScopedPointer<QBackingStore> store(new QBackingStore(&window));
+    store->resize(size);
+
+    QRandomGenerator random(frames);
+    QElapsedTimer timer;
+    timer.start();
+    for (int frame = 0; frame < frames; ++frame) {
+        store->flush(paintFrame(store.data(), pattern, frame, &random));
+        QCoreApplication::processEvents();
+    }
+    const qint64 elapsedNs = qMax<qint64>(1, timer.nsecsElapsed());
+
+    // Paint a last frame in a known color and see what the server shows
+    int mismatches = 0;
+    if (verify) {
+        const QRect bounds(QPoint(), size);
+        store->beginPaint(bounds);
+        QPainter painter(store->paintDevice());
+        painter.fillRect(bounds, Qt::magenta);
+        painter.end();
+        store->endPaint();
+        store->flush(bounds);
+        waitFor([]() { return false; }, 200);
+        mismatches = verifyWindow(&window, Qt::magenta);
+    }
+
+    // The backing store reports what is left when it is destroyed
+    store.reset();
+
+    const qint64 flushes = qMax<qint64>(1, totals.flushes);
+    printf("%5d  %-3s  %-7s  %-23s  %8.1f  %9.1f  %11.0f  %6lld  %9.2f",
+           window.screen()->depth(),
+           qEnvironmentVariableIsSet("QT_XCB_NO_MITSHM") ? "no" : "yes",
+           patternNames[pattern],
+           qPrintable(totals.path),
+           frames * 1e9 / elapsedNs,
+           totals.requests / flushes,
+           totals.bytes / flushes,
+           totals.stalls,
+           totals.stallTimeUs / 1000.0);
+    if (verify)
+        printf("  %s", mismatches == 0 ? "ok" : mismatches < 0 ? "no grab" : "MISMATCH");
+    printf("\n");
+    fflush(stdout);
+
+    return verify && mismatches != 0 ? 1 : 0;
+}
+
+// Starts Xvfb and returns its display, or an empty string
+static QString startXvfb(QProcess *xvfb, const QSize &size, int depth)
+{
+    xvfb->setProgram(QStringLiteral("Xvfb"));
+    xvfb->setArguments({ QStringLiteral("-displayfd"), QStringLiteral("1"),
+                         QStringLiteral("-screen"), QStringLiteral("0"),
+                         QStringLiteral("%1x%2x%3").arg(size.width()).arg(size.height()).arg(depth),
+                         QStringLiteral("-nolisten"), QStringLiteral("tcp") });
+    xvfb->setStandardErrorFile(QProcess::nullDevice());
+    xvfb->start();
+    if (!xvfb->waitForStarted()) {
+        fprintf(stderr, "could not start Xvfb: %s\n", qPrintable(xvfb->errorString()));
+        return QString();
+    }
+
+    // With -displayfd, Xvfb writes its display number once it is ready
+    QByteArray output;
+    while (!output.contains('\n') && xvfb->waitForReadyRead(5000))
+        output += xvfb->readAllStandardOutput();
+
+    bool ok = false;
+    const int displayNumber = output.trimmed().toInt(&ok);
+    if (!ok) {
+        fprintf(stderr, "Xvfb at depth %d did not come up\n", depth);
+        return QString();
+    }
+    return QStringLiteral(":%1").arg(displayNumber);
+}
+
+static int runPatterns(const QString &display, const QStringList &childArguments,
+                       const QStringList &patterns, bool present, int buffers)
+{
+    int result = 0;
+    for (bool shm : { true, false }) {
+        for (const QString &pattern : patterns) {
+            QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+            environment.insert(QStringLiteral("DISPLAY"), display);
+            environment.insert(QStringLiteral("QT_QPA_PLATFORM"), QStringLiteral("meego"));
+            if (shm)
+                environment.remove(QStringLiteral("QT_XCB_NO_MITSHM"));
+            else
+                environment.insert(QStringLiteral("QT_XCB_NO_MITSHM"), QStringLiteral("1"));
+            if (present)
+                environment.insert(QStringLiteral("QT_XCB_PRESENT"), QStringLiteral("1"));
+            if (buffers > 0)
+                environment.insert(QStringLiteral("QT_XCB_BACKINGSTORE_BUFFERS"), QString::number(buffers));
+
+            QProcess child;
+            child.setProcessEnvironment(environment);
+            child.setProcessChannelMode(QProcess::ForwardedChannels);
+            child.start(QCoreApplication::applicationFilePath(),
+                        QStringList{ QStringLiteral("--run"), pattern } + childArguments);
+            if (!child.waitForFinished(-1) || child.exitStatus() != QProcess::NormalExit
+                    || child.exitCode() != 0) {
+                fprintf(stderr, "run of %s %s MIT-SHM failed\n", qPrintable(pattern),
+                        shm ? "with" : "without");
+                result = 1;
+            }
+        }
+    }
+    return result;
+}
+
+static QSize parseSize(const QString &value)
+{
+    const QStringList parts = value.split(QLatin1Char('x'));
+    if (parts.size() != 2)
+        return QSize();
+    return QSize(parts.at(0).toInt(), parts.at(1).toInt());
+}
+
+int main(int argc, char **argv)
+{
+    bool isRun = false;
+    for (int i = 1; i < argc; ++i) {
+        if (!qstrcmp(argv[i], "--run"))
+            isRun = true;
+    }
+
+    QScopedPointer<QCoreApplication> app;
+    if (isRun) {
+        QLoggingCategory::setFilterRules(QStringLiteral("qt.qpa.xcb.backingstore.debug=true"));
+        qInstallMessageHandler(messageHandler);
+        app.reset(new QGuiApplication(argc, argv));
+    } else {
+        app.reset(new QCoreApplication(argc, argv));
+    }
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Backing store throughput benchmark"));
+    parser.addHelpOption();
+    const QCommandLineOption runOption(QStringLiteral("run"),
+            QStringLiteral("Run <pattern> on the current display and exit."), QStringLiteral("pattern"));
+    const QCommandLineOption patternsOption(QStringLiteral("patterns"),
+            QStringLiteral("Comma separated patterns: full, rects, scroll, alpha."),
+            QStringLiteral("patterns"), QStringLiteral("full,rects,scroll,alpha"));
+    const QCommandLineOption depthsOption(QStringLiteral("depths"),
+            QStringLiteral("Comma separated Xvfb depths."), QStringLiteral("depths"),
+            QStringLiteral("16,24,30"));
+    const QCommandLineOption displayOption(QStringLiteral("display"),
+            QStringLiteral("Run against <display> instead of starting Xvfb."), QStringLiteral("display"));
+    const QCommandLineOption framesOption(QStringLiteral("frames"),
+            QStringLiteral("Frames per run."), QStringLiteral("frames"), QStringLiteral("300"));
+    const QCommandLineOption sizeOption(QStringLiteral("size"),
+            QStringLiteral("Window size."), QStringLiteral("WxH"), QStringLiteral("800x600"));
+    const QCommandLineOption presentOption(QStringLiteral("present"),
+            QStringLiteral("Flush with X Present (QT_XCB_PRESENT)."));
+    const QCommandLineOption buffersOption(QStringLiteral("buffers"),
+            QStringLiteral("Backing store buffers (QT_XCB_BACKINGSTORE_BUFFERS)."), QStringLiteral("count"));
+    const QCommandLineOption verifyOption(QStringLiteral("verify"),
+            QStringLiteral("Check what the server shows after each run."));
+    const QCommandLineOption verboseOption(QStringLiteral("verbose"),
+            QStringLiteral("Print the backing store reports as they come."));
+    parser.addOptions({ runOption, patternsOption, depthsOption, displayOption, framesOption,
+                        sizeOption, presentOption, buffersOption, verifyOption, verboseOption });
+    parser.process(*app);
+
+    const QSize size = parseSize(parser.value(sizeOption));
+    const int frames = parser.value(framesOption).toInt();
+    if (size.width() < 32 || size.height() < 32 || frames <= 0) {
+        fprintf(stderr, "invalid size or frame count\n");
+        return 1;
+    }
+    verbose = parser.isSet(verboseOption);
+
+    if (isRun) {
+        Pattern pattern;
+        if (!patternFromName(parser.value(runOption), &pattern)) {
+            fprintf(stderr, "unknown pattern %s\n", qPrintable(parser.value(runOption)));
+            return 1;
+        }
+        return runPattern(pattern, size, frames, parser.isSet(verifyOption));
+    }
+
+    const QStringList patterns = parser.value(patternsOption).split(QLatin1Char(','));
+    for (const QString &name : patterns) {
+        Pattern pattern;
+        if (!patternFromName(name, &pattern)) {
+            fprintf(stderr, "unknown pattern %s\n", qPrintable(name));
+            return 1;
+        }
+    }
+
+    QStringList childArguments = { QStringLiteral("--frames"), QString::number(frames),
+                                    QStringLiteral("--size"), parser.value(sizeOption) };
+    if (parser.isSet(verifyOption))
+        childArguments << QStringLiteral("--verify");
+    if (verbose)
+        childArguments << QStringLiteral("--verbose");
+    const bool present = parser.isSet(presentOption);
+    const int buffers = parser.value(buffersOption).toInt();
+
+    printf("%5s  %-3s  %-7s  %-23s  %8s  %9s  %11s  %6s  %9s\n", "depth", "shm", "pattern", "path/bpp",
+           "fps", "req/flush", "bytes/flush", "stalls", "stall ms");
+    fflush(stdout);
+
+    if (parser.isSet(displayOption))
+        return runPatterns(parser.value(displayOption), childArguments, patterns, present, buffers);
+
+    int result = 0;
+    // Leave room around the window, so that it fits on the screen
+    const QSize screenSize = size + QSize(64, 64);
+    for (const QString &depth : parser.value(depthsOption).split(QLatin1Char(','))) {
+        QProcess xvfb;
+        const QString display = startXvfb(&xvfb, screenSize, depth.toInt());
+        if (display.isEmpty()) {
+            result = 1;
+            continue;
+        }
+        if (runPatterns(display, childArguments, patterns, present, buffers) != 0)
+            result = 1;
+        xvfb.terminate();
+        xvfb.waitForFinished();
+    }
+    return result;
+}
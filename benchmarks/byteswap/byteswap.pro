@@ -0,0 +1,20 @@
+# Standalone benchmark, not part of the plugin build. Compares the byte
+# swapping kernels of the plugin with a scalar qbswap loop, see main.cpp.
+TEMPLATE = app
+TARGET = byteswap_benchmark
+
+CONFIG += console
+CONFIG -= app_bundle
+
+QT = core core-private
+
+DEFINES += QT_NO_FOREACH
+
+INCLUDEPATH += $$PWD/../..
+
+SOURCES = \
+        main.cpp \
+        $$PWD/../../qxcbbyteswap.cpp
+
+HEADERS = \
+        $$PWD/../../qxcbbyteswap.h
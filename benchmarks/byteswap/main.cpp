@@ -0,0 +1,175 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+/*
+    Times qt_xcb_byteSwap32() and qt_xcb_byteSwap16() with each kernel this
+    build and CPU support (AVX2, SSSE3, SSE2 or NEON) against the scalar
+    qbswap loop uploads used before, on a single row and on a full frame,
+    and checks that they all agree with it.
+*/
+
+#include "qxcbbyteswap.h"
+
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QVector>
+#include <QtCore/QtEndian>
+
+#include <stdio.h>
+
+static const struct {
+    QXcbByteSwapKernel kernel;
+    const char *name;
+} kernels[] = {
+    { ByteSwapScalar, "scalar" },
+    { ByteSwapSse2, "sse2" },
+    { ByteSwapSsse3, "ssse3" },
+    { ByteSwapAvx2, "avx2" },
+    { ByteSwapNeon, "neon" },
+    { ByteSwapBest, "best" }
+};
+
+// The loop copy_swapped() ran before the kernels
+template <typename T>
+static void qbswapLoop(T *dst, const T *src, int count)
+{
+    for (int i = 0; i < count; ++i)
+        dst[i] = qbswap(src[i]);
+}
+
+template <typename T, typename Swap>
+static double megabytesPerSecond(Swap swap, int count, int iterations)
+{
+    QVector<T> src(count);
+    QVector<T> dst(count);
+    for (int i = 0; i < count; ++i)
+        src[i] = T(i * 0x9e3779b9u);
+
+    // Warm up the caches and the branch predictors
+    swap(dst.data(), src.constData(), count);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; ++i)
+        swap(dst.data(), src.constData(), count);
+    const qint64 elapsedNs = qMax<qint64>(1, timer.nsecsElapsed());
+
+    return double(count) * sizeof(T) * iterations * 1000.0 / elapsedNs;
+}
+
+template <typename T, typename Swap>
+static bool agreesWithQbswap(Swap swap)
+{
+    // All lengths up to a few vectors, to cover every tail
+    for (int count = 0; count < 100; ++count) {
+        QVector<T> src(count);
+        QVector<T> expected(count);
+        QVector<T> dst(count);
+        for (int i = 0; i < count; ++i)
+            src[i] = T(i * 0x01020304u + 7);
+        qbswapLoop(expected.data(), src.constData(), count);
+        swap(dst.data(), src.constData(), count);
+        if (dst != expected)
+            return false;
+    }
+    return true;
+}
+
+template <typename T, typename KernelSwap>
+static bool run(const char *type, KernelSwap kernelSwap, int pixels, int iterations)
+{
+    const double scalar = megabytesPerSecond<T>(qbswapLoop<T>, pixels, iterations);
+    printf("%-6s  %-7s  %9d  %10.0f  %7s\n", type, "qbswap", pixels, scalar, "1.00");
+
+    bool ok = true;
+    for (const auto &kernel : kernels) {
+        if (!qt_xcb_byteSwapKernelSupported(kernel.kernel))
+            continue;
+
+        auto swap = [&kernelSwap, &kernel](T *dst, const T *src, int count) {
+            kernelSwap(dst, src, count, kernel.kernel);
+        };
+        const bool agrees = agreesWithQbswap<T>(swap);
+        const double rate = megabytesPerSecond<T>(swap, pixels, iterations);
+        printf("%-6s  %-7s  %9d  %10.0f  %7.2f%s\n", type, kernel.name, pixels, rate,
+               rate / scalar, agrees ? "" : "  WRONG");
+        ok = ok && agrees;
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Byte swap kernel benchmark"));
+    parser.addHelpOption();
+    const QCommandLineOption bytesOption(QStringLiteral("bytes"),
+            QStringLiteral("Megabytes to swap per measurement."), QStringLiteral("megabytes"),
+            QStringLiteral("1000"));
+    parser.addOption(bytesOption);
+    parser.process(app);
+
+    const qint64 totalBytes = parser.value(bytesOption).toLongLong() * 1024 * 1024;
+    if (totalBytes <= 0) {
+        fprintf(stderr, "invalid byte count\n");
+        return 1;
+    }
+
+    // A row of a 1080p window, which stays in the cache, and a whole frame
+    const int sizes[] = { 1920, 1920 * 1080 };
+
+    printf("%-6s  %-7s  %9s  %10s  %7s\n", "pixel", "kernel", "pixels", "MB/s", "speedup");
+    bool ok = true;
+    for (int pixels : sizes) {
+        const int iterations32 = int(qMax<qint64>(1, totalBytes / (pixels * 4)));
+        ok = run<quint32>("32 bit", [](quint32 *dst, const quint32 *src, int count, QXcbByteSwapKernel kernel) {
+            qt_xcb_byteSwap32(dst, src, count, kernel);
+        }, pixels, iterations32) && ok;
+
+        const int iterations16 = int(qMax<qint64>(1, totalBytes / (pixels * 2)));
+        ok = run<quint16>("16 bit", [](quint16 *dst, const quint16 *src, int count, QXcbByteSwapKernel kernel) {
+            qt_xcb_byteSwap16(dst, src, count, kernel);
+        }, pixels, iterations16) && ok;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -31,10 +31,16 @@ SOURCES = \
         qxcbscreen.cpp \
         qxcbwindow.cpp \
         qxcbbackingstore.cpp \
+        qxcbshmarena.cpp \
+        qxcbdamagetiles.cpp \
+        qxcbframeclock.cpp \
+        qxcbmemorypressure.cpp \
+        qxcbflusher.cpp \
         qxcbwmsupport.cpp \
         qxcbnativeinterface.cpp \
         qxcbcursor.cpp \
         qxcbimage.cpp \
+        qxcbbyteswap.cpp \
         qxcbxsettings.cpp \
         qxcbeventqueue.cpp \
         qxcbeventdispatcher.cpp \
@@ -55,10 +61,16 @@ HEADERS = \
         qxcbscreen.h \
         qxcbwindow.h \
         qxcbbackingstore.h \
+        qxcbshmarena.h \
+        qxcbdamagetiles.h \
+        qxcbframeclock.h \
+        qxcbmemorypressure.h \
+        qxcbflusher.h \
         qxcbwmsupport.h \
         qxcbnativeinterface.h \
         qxcbcursor.h \
         qxcbimage.h \
+        qxcbbyteswap.h \
         qxcbxsettings.h \
         qxcbeventqueue.h \
         qxcbeventdispatcher.h \
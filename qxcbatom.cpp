@@ -53,6 +53,8 @@ static const char *xcb_atomnames = {
     "_NET_WM_CONTEXT_HELP\0"
     "_NET_WM_SYNC_REQUEST\0"
     "_NET_WM_SYNC_REQUEST_COUNTER\0"
+    "_NET_WM_FRAME_DRAWN\0"
+    "_NET_WM_FRAME_TIMINGS\0"
 
     // ICCCM window state
     "WM_STATE\0"
@@ -53,6 +53,8 @@ public:
         _NET_WM_CONTEXT_HELP,
         _NET_WM_SYNC_REQUEST,
         _NET_WM_SYNC_REQUEST_COUNTER,
+        _NET_WM_FRAME_DRAWN,
+        _NET_WM_FRAME_TIMINGS,
 
         // ICCCM window state
         WM_STATE,
@@ -42,20 +42,45 @@
 #include "qxcbconnection.h"
 #include "qxcbscreen.h"
 #include "qxcbwindow.h"
+#include "qxcbshmarena.h"
+#include "qxcbdamagetiles.h"
+#include "qxcbflusher.h"
+#include "qxcbimage.h"
 
+#include <xcb/present.h>
 #include <xcb/shm.h>
+#include <xcb/xcbext.h>
 #include <xcb/xcb_image.h>
 #include <xcb/render.h>
 #include <xcb/xcb_renderutil.h>
+#include <xcb/xfixes.h>
 
 #include <sys/ipc.h>
 #include <sys/shm.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 
 #include <stdio.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef MFD_HUGETLB
+#define MFD_HUGETLB 0x0004U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS 1033
+#define F_SEAL_SEAL 0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW 0x0004
+#endif
+
 #include <qdebug.h>
 #include <qpainter.h>
 #include <qscreen.h>
@@ -63,11 +88,24 @@
 #include <qpa/qplatformgraphicsbuffer.h>
 #include <private/qimage_p.h>
 #include <qendian.h>
+#include <QtCore/QPointer>
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVarLengthArray>
 
 #include <algorithm>
 
 QT_BEGIN_NAMESPACE
 
+// Estimated overhead of a single upload request, in bytes of image data, used
+// to decide when uploading a bounding rect beats uploading its parts. SHM puts
+// don't copy the pixels through the socket, so there the per request work of
+// the server weighs more.
+static const int ShmPutRequestCost = 16 * 1024;
+static const int PutImageRequestCost = 2 * 1024;
+
 class QXcbBackingStore;
 
 class QXcbBackingStoreImage : public QXcbObject
@@ -75,9 +113,15 @@ class QXcbBackingStoreImage : public QXcbObject
 public:
     QXcbBackingStoreImage(QXcbBackingStore *backingStore, const QSize &size);
     QXcbBackingStoreImage(QXcbBackingStore *backingStore, const QSize &size, uint depth, QImage::Format format);
-    ~QXcbBackingStoreImage() { destroy(true); }
+    ~QXcbBackingStoreImage();
 
-    void resize(const QSize &size);
+    void resize(const QSize &size, bool liveResize = false);
+    qint64 compact();
+    qint64 releaseTemporaryBuffers();
+
+    QByteArray release(bool keepContent);
+    void restore(const QByteArray &snapshot);
+    bool isReleased() const { return m_releasedSize.isValid(); }
 
     void flushScrolledRegion(bool clientSideScroll);
 
@@ -89,28 +133,62 @@ public:
     QSize size() const { return m_qimage.size(); }
 
     bool hasAlpha() const { return m_hasAlpha; }
-    bool hasShm() const { return m_shm_info.shmaddr != nullptr; }
+    bool hasShm() const { return m_shmBlock.isValid(); }
 
     void put(xcb_drawable_t dst, const QRegion &region, const QPoint &offset);
+    void present(xcb_window_t window, const QRegion &region, const QPoint &offset, uint32_t serial);
+    void handlePresentIdle(xcb_pixmap_t pixmap, uint32_t serial);
     void preparePaint(const QRegion &region);
 
+    void setFlushTicket(quint64 ticket) { m_flushTicket = ticket; }
+    void waitForFlush();
+
+    struct Statistics {
+        qint64 requests = 0;
+        qint64 bytes = 0; // on the wire, including pixel data
+        int stalls = 0;   // times we had to wait for the server or the flusher
+        qint64 stallTimeUs = 0;
+    };
+    Statistics takeStatistics();
+    const char *uploadPath() const;
+
+    bool isBusy();
+    void copyFrom(const QXcbBackingStoreImage &other, const QRegion &region);
+
     static bool createSystemVShmSegment(xcb_connection_t *c, size_t segmentSize = 1,
                                         xcb_shm_segment_info_t *shm_info = nullptr);
+    static bool createMemfdShmSegment(xcb_connection_t *c, size_t segmentSize = 1,
+                                      xcb_shm_segment_info_t *shm_info = nullptr,
+                                      bool hugePages = false);
 
 private:
     void init(const QSize &size, uint depth, QImage::Format format);
+    void allocate(const QSize &size);
+    void setImageSize(const QSize &size);
 
-    void createShmSegment(size_t segmentSize);
-    void destroyShmSegment();
+    void allocateShm(size_t size);
+    void releaseShm();
     void destroy(bool destroyShm);
 
     void ensureGC(xcb_drawable_t dst);
-    void shmPutImage(xcb_drawable_t drawable, const QRegion &region, const QPoint &offset = QPoint());
+    void waitForShm(const QRegion &region);
+    void forgetProcessedShmPuts();
+    void waitForPresentIdle();
+    void shmPutImage(xcb_drawable_t drawable, const QVector<QRect> &rects, const QPoint &offset = QPoint());
     void flushPixmap(const QRegion &region, bool fullRegion = false);
+    void putPixmap(const QVector<QRect> &rects);
+    bool putImageRows(const QRect &rect, quint32 stride);
+    QVector<QRect> changedRows(const QVector<QRect> &rects);
+    void invalidateRowHashes(const QRect &rect);
+    void reportRowHashing(bool force);
+    void countRequest(size_t bytes);
+    void countStall(const QElapsedTimer &timer);
+
+    QVector<QRect> pendingFlushRects(const QRect &clip, int requestCost) const;
+    QVector<QRect> uploadRects(const QRegion &region, int requestCost) const;
     void setClip(const QRegion &region);
 
-    xcb_shm_segment_info_t m_shm_info;
-    size_t m_segmentSize = 0;
+    QXcbShmArena::Block m_shmBlock;
     QXcbBackingStore *m_backingStore = nullptr;
 
     xcb_image_t *m_xcb_image = nullptr;
@@ -127,18 +205,63 @@ private:
     // the regions we need and only when these are marked dirty. This way we can just
     // do a server-side copy on expose instead of sending the pixels every time
     xcb_pixmap_t m_xcb_pixmap = 0;
-    QRegion m_pendingFlush;
+    QXcbDamageTiles m_pendingFlush;
+
+    // Whether m_xcb_pixmap is an SHM pixmap sharing the memory of the image, in
+    // which case it is always up to date and scrolling is done in the image
+    bool m_shmPixmap = false;
+
+    // The serial of the last PresentPixmap request for m_xcb_pixmap, and
+    // whether the server may still be reading from the pixmap for it
+    uint32_t m_presentSerial = 0;
+    bool m_presentPending = false;
+
+    // The flusher job which is sending put() requests for the image, if any.
+    // Until it is done the image must not be changed.
+    quint64 m_flushTicket = 0;
 
     // This is the scrolled region which is stored in server-side pixmap
     QRegion m_scrolledRegion;
 
-    // When using shared memory this is the region currently shared with the server
-    QRegion m_dirtyShm;
+    // When using shared memory these are the regions the server may still be reading
+    // from, together with the sequence number of the last put request reading them.
+    // That request generates an event, so its completion can be waited for.
+    struct PendingShmPut {
+        QVector<QRect> rects;
+        uint sequence;
+    };
+    QVector<PendingShmPut> m_pendingShmPuts;
 
     // When not using shared memory this is a temporary buffer which is uploaded
     // as a pixmap region to server
     QByteArray m_flushBuffer;
 
+    // Ring of temporary buffers for large uploads, which are converted on
+    // worker threads while earlier chunks are being sent
+    enum { StagingBufferCount = 4 };
+    QByteArray m_stagingBuffers[StagingBufferCount];
+
+    // When not using shared memory and QT_XCB_HASH_UPLOADS is set, the hash of
+    // the last content uploaded to each row of the server-side pixmap, so that
+    // rows which didn't change are not sent again
+    struct RowHash {
+        quint64 hash = 0;
+        int x = 0;
+        int width = 0; // 0 if the row content is unknown
+    };
+    QVector<RowHash> m_rowHashes;
+    qint64 m_uploadedBytes = 0;
+    qint64 m_skippedBytes = 0;
+    QElapsedTimer m_rowHashReportTimer;
+
+    // Counted by whichever thread is sending the requests for the image,
+    // taken by the backing store when it reports
+    Statistics m_statistics;
+
+    // While released, the size and stride of the image the snapshot was taken from
+    QSize m_releasedSize;
+    int m_releasedBytesPerLine = 0;
+
     bool m_hasAlpha = false;
     bool m_clientSideScroll = false;
 
@@ -207,14 +330,149 @@ void QXcbBackingStoreImage::init(const QSize &size, uint depth, QImage::Format f
     if (!m_hasAlpha)
         m_qimage_format = qt_maybeAlphaVersionWithSameDepth(m_qimage_format);
 
-    memset(&m_shm_info, 0, sizeof m_shm_info);
+    resize(size);
+}
+
+QXcbBackingStoreImage::~QXcbBackingStoreImage()
+{
+    waitForFlush();
+    reportRowHashing(true);
+    destroy(true);
+}
+
+void QXcbBackingStoreImage::resize(const QSize &size, bool liveResize)
+{
+    waitForFlush();
+
+    // During an interactive resize keep the allocation as long as the new
+    // size fits in, and only adjust the part of it that is in use.
+    if (liveResize && m_xcb_image && m_xcb_image->data
+            && size.width() <= m_xcb_image->width && size.height() <= m_xcb_image->height) {
+        setImageSize(size);
+        return;
+    }
+
+    // Leave some headroom when growing during an interactive resize,
+    // so that the following size changes can reuse the allocation.
+    QSize allocationSize = size;
+    if (liveResize && !size.isEmpty())
+        allocationSize += QSize(qMax(size.width() / 4, 64), qMax(size.height() / 4, 64));
+
+    allocate(allocationSize);
+    setImageSize(size);
+}
+
+/*!
+    Shrinks the allocation to the size in use after an interactive
+    resize, keeping the content, and returns the number of bytes released.
+*/
+qint64 QXcbBackingStoreImage::compact()
+{
+    if (!m_xcb_image || m_qimage.isNull())
+        return 0;
+    if (m_xcb_image->width == m_qimage.width() && m_xcb_image->height == m_qimage.height())
+        return 0;
+    const qint64 allocatedBytes = qint64(m_xcb_image->stride) * m_xcb_image->height;
+
+    // Bring back the content which only lives in the server-side pixmap
+    flushScrolledRegion(true);
+
+    const QImage content = m_qimage.copy();
+    resize(content.size());
+    if (m_qimage.isNull())
+        return 0;
+
+    if (hasShm())
+        waitForShm(QRect(QPoint(), content.size()));
+
+    const int bytesPerLine = qMin(content.bytesPerLine(), m_qimage.bytesPerLine());
+    for (int y = 0; y < content.height(); ++y)
+        memcpy(m_qimage.scanLine(y), content.constScanLine(y), bytesPerLine);
 
+    // The new server-side pixmap has no content yet
+    m_pendingFlush.add(QRect(QPoint(), m_qimage.size()));
+
+    return allocatedBytes - qint64(m_xcb_image->stride) * m_xcb_image->height;
+}
+
+/*!
+    Frees the buffers used to convert and upload content, which are allocated
+    again by the next flush that needs them, and returns their size.
+*/
+qint64 QXcbBackingStoreImage::releaseTemporaryBuffers()
+{
+    waitForFlush();
+
+    qint64 releasedBytes = m_flushBuffer.capacity();
+    m_flushBuffer = QByteArray();
+    for (QByteArray &buffer : m_stagingBuffers) {
+        releasedBytes += buffer.capacity();
+        buffer = QByteArray();
+    }
+    return releasedBytes;
+}
+
+/*!
+    Frees the image memory and the server-side pixmap. If \a keepContent is
+    \c true, the content is returned compressed, to be passed to restore().
+*/
+QByteArray QXcbBackingStoreImage::release(bool keepContent)
+{
+    waitForFlush();
+    if (!m_xcb_image || m_qimage.isNull())
+        return QByteArray();
+
+    // Bring back the content which only lives in the server-side pixmap
+    if (keepContent)
+        flushScrolledRegion(true);
+
+    QByteArray snapshot;
+    if (keepContent)
+        snapshot = qCompress(m_qimage.constBits(), int(m_qimage.sizeInBytes()), 1);
+
+    m_releasedSize = m_qimage.size();
+    m_releasedBytesPerLine = m_qimage.bytesPerLine();
+
+    reportRowHashing(true);
+    destroy(true);
+    m_pendingFlush.clear();
+    m_scrolledRegion = QRegion();
+    m_rowHashes.clear();
+    m_clientSideScroll = false;
+
+    return snapshot;
+}
+
+/*!
+    Allocates the image again after release(), with the content from
+    \a snapshot if there is one.
+*/
+void QXcbBackingStoreImage::restore(const QByteArray &snapshot)
+{
+    if (!isReleased())
+        return;
+
+    const QSize size = m_releasedSize;
+    m_releasedSize = QSize();
     resize(size);
+    if (m_qimage.isNull())
+        return;
+
+    const QByteArray content = snapshot.isEmpty() ? QByteArray() : qUncompress(snapshot);
+    if (content.size() >= qint64(m_releasedBytesPerLine) * size.height()) {
+        const int bytesPerLine = qMin(m_releasedBytesPerLine, m_qimage.bytesPerLine());
+        for (int y = 0; y < size.height(); ++y)
+            memcpy(m_qimage.scanLine(y), content.constData() + y * m_releasedBytesPerLine, bytesPerLine);
+    }
+
+    // The new server-side pixmap has no content yet
+    m_pendingFlush.add(QRect(QPoint(), m_qimage.size()));
 }
 
-void QXcbBackingStoreImage::resize(const QSize &size)
+void QXcbBackingStoreImage::allocate(const QSize &size)
 {
     destroy(false);
+    m_pendingFlush.clear();
 
     auto byteOrder = QSysInfo::ByteOrder == QSysInfo::BigEndian ? XCB_IMAGE_ORDER_MSB_FIRST
                                                                 : XCB_IMAGE_ORDER_LSB_FIRST;
@@ -231,23 +489,23 @@ void QXcbBackingStoreImage::resize(const QSize &size)
 
     if (connection()->hasShm()) {
         if (segmentSize == 0) {
-            if (m_segmentSize > 0) {
-                destroyShmSegment();
+            if (m_shmBlock.isValid()) {
+                releaseShm();
                 qCDebug(lcQpaXcb) << "[" << m_backingStore->window()
-                                  << "] destroyed SHM segment due to resize to" << size;
+                                  << "] released shared memory due to resize to" << size;
             }
         } else {
-            // Destroy shared memory segment if it is double (or more) of what we actually
+            // Release shared memory if it is double (or more) of what we actually
             // need with new window size. Or if the new size is bigger than what we currently
             // have allocated.
-            if (m_shm_info.shmaddr && (m_segmentSize < segmentSize || m_segmentSize / 2 >= segmentSize))
-                destroyShmSegment();
-            if (!m_shm_info.shmaddr) {
+            if (m_shmBlock.isValid() && (m_shmBlock.size < segmentSize || m_shmBlock.size / 2 >= segmentSize))
+                releaseShm();
+            if (!m_shmBlock.isValid()) {
                 qCDebug(lcQpaXcb) << "[" << m_backingStore->window()
-                                  << "] creating shared memory" << segmentSize << "bytes for"
+                                  << "] allocating shared memory" << segmentSize << "bytes for"
                                   << size << "depth" << m_xcb_format->depth << "bits"
                                   << m_xcb_format->bits_per_pixel;
-                createShmSegment(segmentSize);
+                allocateShm(segmentSize);
             }
         }
     }
@@ -255,32 +513,66 @@ void QXcbBackingStoreImage::resize(const QSize &size)
     if (segmentSize == 0)
         return;
 
-    m_xcb_image->data = m_shm_info.shmaddr ? m_shm_info.shmaddr : (uint8_t *)malloc(segmentSize);
-    m_qimage = QImage(static_cast<uchar *>(m_xcb_image->data), m_xcb_image->width,
-                      m_xcb_image->height, m_xcb_image->stride, m_qimage_format);
-    m_graphics_buffer = new QXcbGraphicsBuffer(&m_qimage);
+    m_xcb_image->data = m_shmBlock.isValid() ? m_shmBlock.data() : (uint8_t *)malloc(segmentSize);
 
     m_xcb_pixmap = xcb_generate_id(xcb_connection());
     auto xcbScreen = static_cast<QXcbScreen *>(m_backingStore->window()->screen()->handle());
-    xcb_create_pixmap(xcb_connection(),
-                      m_xcb_image->depth,
-                      m_xcb_pixmap,
-                      xcbScreen->root(),
-                      m_xcb_image->width, m_xcb_image->height);
+    m_shmPixmap = hasShm() && connection()->hasShmPixmaps();
+    if (m_shmPixmap) {
+        xcb_shm_create_pixmap(xcb_connection(),
+                              m_xcb_pixmap,
+                              xcbScreen->root(),
+                              m_xcb_image->width, m_xcb_image->height,
+                              m_xcb_image->depth,
+                              m_shmBlock.shmseg,
+                              m_shmBlock.offset);
+    } else {
+        xcb_create_pixmap(xcb_connection(),
+                          m_xcb_image->depth,
+                          m_xcb_pixmap,
+                          xcbScreen->root(),
+                          m_xcb_image->width, m_xcb_image->height);
+    }
+
+    // The content of the new pixmap is unknown
+    static const bool hashUploads = qEnvironmentVariableIsSet("QT_XCB_HASH_UPLOADS");
+    m_rowHashes.clear();
+    if (hashUploads && !hasShm())
+        m_rowHashes.resize(m_xcb_image->height);
+}
+
+void QXcbBackingStoreImage::setImageSize(const QSize &size)
+{
+    delete m_graphics_buffer;
+    m_graphics_buffer = nullptr;
+    m_qimage = QImage();
+
+    if (!m_xcb_image || !m_xcb_image->data)
+        return;
+
+    // The image may use only part of the allocation, with the stride of all of it
+    Q_ASSERT(size.width() <= m_xcb_image->width && size.height() <= m_xcb_image->height);
+    m_qimage = QImage(static_cast<uchar *>(m_xcb_image->data), size.width(), size.height(),
+                      m_xcb_image->stride, m_qimage_format);
+    m_graphics_buffer = new QXcbGraphicsBuffer(&m_qimage);
+
+    m_pendingFlush.resize(size);
+    m_scrolledRegion &= QRect(QPoint(), size);
 }
 
 void QXcbBackingStoreImage::destroy(bool destroyShm)
 {
     if (m_xcb_image) {
         if (m_xcb_image->data) {
-            if (m_shm_info.shmaddr) {
+            if (m_shmBlock.isValid()) {
                 if (destroyShm)
-                    destroyShmSegment();
+                    releaseShm();
             } else {
                 free(m_xcb_image->data);
             }
         }
         xcb_image_destroy(m_xcb_image);
+        m_xcb_image = nullptr;
     }
 
     if (m_gc) {
@@ -296,12 +588,16 @@ void QXcbBackingStoreImage::destroy(bool destroyShm)
         xcb_free_pixmap(xcb_connection(), m_xcb_pixmap);
         m_xcb_pixmap = 0;
     }
+    m_shmPixmap = false;
+    m_presentPending = false;
 
     m_qimage = QImage();
 }
 
 void QXcbBackingStoreImage::flushScrolledRegion(bool clientSideScroll)
 {
+    waitForFlush();
+
     if (m_clientSideScroll == clientSideScroll)
        return;
 
@@ -310,31 +606,66 @@ void QXcbBackingStoreImage::flushScrolledRegion(bool clientSideScroll)
     if (m_scrolledRegion.isNull())
         return;
 
-    if (hasShm() && m_dirtyShm.intersects(m_scrolledRegion)) {
-        connection()->sync();
-        m_dirtyShm = QRegion();
-    }
+    if (hasShm())
+        waitForShm(m_scrolledRegion);
 
     if (m_clientSideScroll) {
-        // Copy scrolled image region from server-side pixmap to client-side memory
+        // Copy scrolled image region from server-side pixmap to client-side memory.
+        // Send all requests before waiting for any reply, so that it takes a
+        // single round trip. Rows spanning the whole image can be written by the
+        // server straight into the shared memory segment.
+        struct PendingGet {
+            QRect rect;
+            bool shm;
+            xcb_get_image_cookie_t cookie;
+            xcb_shm_get_image_cookie_t shmCookie;
+        };
+        QVector<PendingGet> gets;
+        gets.reserve(m_scrolledRegion.rectCount());
         for (const QRect &rect : m_scrolledRegion) {
-            const int w = rect.width();
-            const int h = rect.height();
-
-            auto reply = Q_XCB_REPLY_UNCHECKED(xcb_get_image,
-                                               xcb_connection(),
-                                               m_xcb_image->format,
-                                               m_xcb_pixmap,
-                                               rect.x(), rect.y(),
-                                               w, h,
-                                               ~0u);
-
-            if (reply && reply->depth == m_xcb_image->depth) {
-                const QImage img(xcb_get_image_data(reply.get()), w, h, m_qimage.format());
-
-                QPainter p(&m_qimage);
-                p.setCompositionMode(QPainter::CompositionMode_Source);
-                p.drawImage(rect.topLeft(), img);
+            PendingGet get;
+            get.rect = rect;
+            get.shm = hasShm() && rect.x() == 0 && rect.width() == m_xcb_image->width;
+            if (get.shm) {
+                get.shmCookie = xcb_shm_get_image_unchecked(xcb_connection(),
+                                                            m_xcb_pixmap,
+                                                            rect.x(), rect.y(),
+                                                            rect.width(), rect.height(),
+                                                            ~0u,
+                                                            m_xcb_image->format,
+                                                            m_shmBlock.shmseg,
+                                                            m_shmBlock.offset + rect.y() * m_xcb_image->stride);
+            } else {
+                get.cookie = xcb_get_image_unchecked(xcb_connection(),
+                                                     m_xcb_image->format,
+                                                     m_xcb_pixmap,
+                                                     rect.x(), rect.y(),
+                                                     rect.width(), rect.height(),
+                                                     ~0u);
+            }
+            gets.append(get);
+        }
+
+        const int bytesPerPixel = m_qimage.depth() >> 3;
+        for (const PendingGet &get : qAsConst(gets)) {
+            if (get.shm) {
+                // The reply tells that the server is done writing
+                free(xcb_shm_get_image_reply(xcb_connection(), get.shmCookie, nullptr));
+                continue;
+            }
+
+            std::unique_ptr<xcb_get_image_reply_t, QStdFreeDeleter> reply(
+                    xcb_get_image_reply(xcb_connection(), get.cookie, nullptr));
+            if (!reply || reply->depth != m_xcb_image->depth)
+                continue;
+
+            const QRect &rect = get.rect;
+            const uchar *src = xcb_get_image_data(reply.get());
+            const int srcBytesPerLine = xcb_get_image_data_length(reply.get()) / rect.height();
+            const int rowBytes = qMin(rect.width() * bytesPerPixel, srcBytesPerLine);
+            for (int y = 0; y < rect.height(); ++y) {
+                memcpy(m_qimage.scanLine(rect.y() + y) + rect.x() * bytesPerPixel,
+                       src + y * srcBytesPerLine, rowBytes);
             }
         }
         m_scrolledRegion = QRegion();
@@ -342,20 +673,107 @@ void QXcbBackingStoreImage::flushScrolledRegion(bool clientSideScroll)
         // Copy scrolled image region from client-side memory to server-side pixmap
         ensureGC(m_xcb_pixmap);
         if (hasShm())
-            shmPutImage(m_xcb_pixmap, m_scrolledRegion);
+            shmPutImage(m_xcb_pixmap, uploadRects(m_scrolledRegion, ShmPutRequestCost));
         else
             flushPixmap(m_scrolledRegion, true);
     }
 }
 
-void QXcbBackingStoreImage::createShmSegment(size_t segmentSize)
+void QXcbBackingStoreImage::allocateShm(size_t size)
 {
     Q_ASSERT(connection()->hasShm());
-    Q_ASSERT(m_segmentSize == 0);
-    {
-        if (createSystemVShmSegment(xcb_connection(), segmentSize, &m_shm_info))
-            m_segmentSize = segmentSize;
+    Q_ASSERT(!m_shmBlock.isValid());
+
+    m_shmBlock = connection()->shmArena()->allocate(size);
+}
+
+void QXcbBackingStoreImage::releaseShm()
+{
+    // The block may be handed out again right away, so tell the arena
+    // which put the server has to finish before it can be overwritten.
+    const uint lastUseSequence = m_pendingShmPuts.isEmpty() ? 0 : m_pendingShmPuts.constLast().sequence;
+    connection()->shmArena()->release(m_shmBlock, lastUseSequence);
+
+    m_shmBlock = QXcbShmArena::Block();
+    m_pendingShmPuts.clear();
+}
+
+static int qt_memfd_create(const char *name, unsigned int flags)
+{
+#ifdef SYS_memfd_create
+    return syscall(SYS_memfd_create, name, flags);
+#else
+    Q_UNUSED(name);
+    Q_UNUSED(flags);
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+bool QXcbBackingStoreImage::createMemfdShmSegment(xcb_connection_t *c, size_t segmentSize,
+                                                  xcb_shm_segment_info_t *shmInfo, bool hugePages)
+{
+    int fd = -1;
+    if (hugePages) {
+        fd = qt_memfd_create("qt-xcb-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING | MFD_HUGETLB);
+        if (fd == -1 || ftruncate(fd, segmentSize) == -1) {
+            qCDebug(lcQpaXcb, "huge page backed memfd failed (%d: %s) for size %zu",
+                    errno, strerror(errno), segmentSize);
+            if (fd != -1)
+                close(fd);
+            fd = -1;
+        }
+    }
+    if (fd == -1) {
+        fd = qt_memfd_create("qt-xcb-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (fd == -1) {
+            qCWarning(lcQpaXcb, "memfd_create() failed (%d: %s)", errno, strerror(errno));
+            return false;
+        }
+        if (ftruncate(fd, segmentSize) == -1) {
+            qCWarning(lcQpaXcb, "ftruncate() failed (%d: %s) for size %zu",
+                      errno, strerror(errno), segmentSize);
+            close(fd);
+            return false;
+        }
+    }
+
+    // The size is final, so neither we nor the server can pull pages from under the other
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) == -1)
+        qCDebug(lcQpaXcb, "failed to seal memfd (%d: %s)", errno, strerror(errno));
+
+    // Prefault large segments, so that the first paint into a big window does not
+    // take a page fault for every page of the backing store
+    const size_t populateThreshold = 4 * 1024 * 1024;
+    const int flags = MAP_SHARED | (segmentSize >= populateThreshold ? MAP_POPULATE : 0);
+    void *addr = mmap(nullptr, segmentSize, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (addr == MAP_FAILED) {
+        qCWarning(lcQpaXcb, "mmap() failed (%d: %s) for size %zu", errno, strerror(errno), segmentSize);
+        close(fd);
+        return false;
     }
+
+    // xcb takes ownership of the file descriptor and closes it once it has been sent
+    const auto seg = xcb_generate_id(c);
+    auto cookie = xcb_shm_attach_fd_checked(c, seg, fd, false);
+    auto *error = xcb_request_check(c, cookie);
+    if (error) {
+        qCWarning(lcQpaXcb(), "xcb_shm_attach_fd() failed");
+        free(error);
+        if (munmap(addr, segmentSize) == -1)
+            qCWarning(lcQpaXcb, "munmap() failed (%d: %s) for %p", errno, strerror(errno), addr);
+        return false;
+    } else if (!shmInfo) { // this was a test run, free the allocated test segment
+        xcb_shm_detach(c, seg);
+        if (munmap(addr, segmentSize) == -1)
+            qCWarning(lcQpaXcb, "munmap() failed (%d: %s) for %p", errno, strerror(errno), addr);
+    }
+    if (shmInfo) {
+        shmInfo->shmseg = seg;
+        shmInfo->shmid = 0; // unused
+        shmInfo->shmaddr = static_cast<quint8 *>(addr);
+    }
+    return true;
 }
 
 bool QXcbBackingStoreImage::createSystemVShmSegment(xcb_connection_t *c, size_t segmentSize,
@@ -399,34 +817,28 @@ bool QXcbBackingStoreImage::createSystemVShmSegment(xcb_connection_t *c, size_t
     return true;
 }
 
-void QXcbBackingStoreImage::destroyShmSegment()
-{
-    auto cookie = xcb_shm_detach_checked(xcb_connection(), m_shm_info.shmseg);
-    xcb_generic_error_t *error = xcb_request_check(xcb_connection(), cookie);
-    if (error)
-        connection()->printXcbError("xcb_shm_detach() failed with error", error);
-    m_shm_info.shmseg = 0;
-
-    {
-        if (shmdt(m_shm_info.shmaddr) == -1) {
-            qCWarning(lcQpaXcb, "shmdt() failed (%d: %s) for %p",
-                      errno, strerror(errno), m_shm_info.shmaddr);
-        }
-        m_shm_info.shmid = 0; // unused
-    }
-    m_shm_info.shmaddr = nullptr;
-
-    m_segmentSize = 0;
-}
-
 extern void qt_scrollRectInImage(QImage &img, const QRect &rect, const QPoint &offset);
 
 bool QXcbBackingStoreImage::scroll(const QRegion &area, int dx, int dy)
 {
+    waitForFlush();
+
     const QRect bounds(QPoint(), size());
     const QRegion scrollArea(area & bounds);
     const QPoint delta(dx, dy);
 
+    if (m_shmPixmap) {
+        // The pixmap shares the memory of the image, so scrolling the image
+        // scrolls both once the server is done reading from there.
+        if (m_qimage.isNull())
+            return false;
+
+        waitForShm(scrollArea | scrollArea.translated(delta));
+        for (const QRect &rect : scrollArea)
+            qt_scrollRectInImage(m_qimage, rect, delta);
+        return true;
+    }
+
     if (m_clientSideScroll) {
         if (m_qimage.isNull())
             return false;
@@ -438,7 +850,7 @@ bool QXcbBackingStoreImage::scroll(const QRegion &area, int dx, int dy)
             qt_scrollRectInImage(m_qimage, rect, delta);
     } else {
         if (hasShm())
-            shmPutImage(m_xcb_pixmap, m_pendingFlush.intersected(scrollArea));
+            shmPutImage(m_xcb_pixmap, pendingFlushRects(scrollArea.boundingRect(), ShmPutRequestCost));
         else
             flushPixmap(scrollArea);
 
@@ -446,6 +858,7 @@ bool QXcbBackingStoreImage::scroll(const QRegion &area, int dx, int dy)
 
         for (const QRect &src : scrollArea) {
             const QRect dst = src.translated(delta).intersected(bounds);
+            invalidateRowHashes(dst);
             xcb_copy_area(xcb_connection(),
                           m_xcb_pixmap,
                           m_xcb_pixmap,
@@ -453,13 +866,14 @@ bool QXcbBackingStoreImage::scroll(const QRegion &area, int dx, int dy)
                           src.x(), src.y(),
                           dst.x(), dst.y(),
                           dst.width(), dst.height());
+            countRequest(sizeof(xcb_copy_area_request_t));
         }
     }
 
     m_scrolledRegion |= scrollArea.translated(delta).intersected(bounds);
     if (hasShm()) {
-        m_pendingFlush -= scrollArea;
-        m_pendingFlush -= m_scrolledRegion;
+        m_pendingFlush.subtract(scrollArea);
+        m_pendingFlush.subtract(m_scrolledRegion);
     }
 
     return true;
@@ -496,6 +910,16 @@ static inline void copy_unswapped(char *dst, int dstBytesPerLine, const QImage &
     }
 }
 
+static inline void byte_swap(quint32 *dst, const quint32 *src, int count)
+{
+    qt_xcb_byteSwap32(dst, src, count);
+}
+
+static inline void byte_swap(quint16 *dst, const quint16 *src, int count)
+{
+    qt_xcb_byteSwap16(dst, src, count);
+}
+
 template <class Pixel>
 static inline void copy_swapped(char *dst, const int dstStride, const QImage &img, const QRect &rect)
 {
@@ -510,18 +934,14 @@ static inline void copy_swapped(char *dst, const int dstStride, const QImage &im
         Pixel *dstPixels = reinterpret_cast<Pixel *>(dst);
         const Pixel *srcPixels = reinterpret_cast<const Pixel *>(srcData + yy * srcBytesPerLine) + left;
 
-        for (int i = 0; i < width; ++i)
-            dstPixels[i] = qbswap<Pixel>(*srcPixels++);
+        byte_swap(dstPixels, srcPixels, width);
 
         dst += dstStride;
     }
 }
 
-static QImage native_sub_image(QByteArray *buffer, const int dstStride, const QImage &src, const QRect &rect, bool swap)
+static void convert_sub_image(QByteArray *buffer, const int dstStride, const QImage &src, const QRect &rect, bool swap)
 {
-    if (!swap && src.rect() == rect && src.bytesPerLine() == dstStride)
-        return src;
-
     buffer->resize(rect.height() * dstStride);
 
     if (swap) {
@@ -536,6 +956,14 @@ static QImage native_sub_image(QByteArray *buffer, const int dstStride, const QI
     } else {
         copy_unswapped(buffer->data(), dstStride, src, rect);
     }
+}
+
+static QImage native_sub_image(QByteArray *buffer, const int dstStride, const QImage &src, const QRect &rect, bool swap)
+{
+    if (!swap && src.rect() == rect && src.bytesPerLine() == dstStride)
+        return src;
+
+    convert_sub_image(buffer, dstStride, src, rect, swap);
 
     return QImage(reinterpret_cast<const uchar *>(buffer->constData()), rect.width(), rect.height(), dstStride, src.format());
 }
@@ -545,36 +973,166 @@ static inline quint32 round_up_scanline(quint32 base, quint32 pad)
     return (base + pad - 1) & -pad;
 }
 
-void QXcbBackingStoreImage::shmPutImage(xcb_drawable_t drawable, const QRegion &region, const QPoint &offset)
+// Uploads at least this large are converted on worker threads, in chunks
+// of at most PipelinedChunkBytes so that conversion overlaps with sending
+static const qint64 PipelinedFlushBytes = 1024 * 1024;
+static const quint32 PipelinedChunkBytes = 256 * 1024;
+
+// Rows of a PutImage request sent straight from the image each take an
+// iovec, keep them well below IOV_MAX
+static const int MaxPutImageRows = 512;
+
+class QXcbFlushThreadPool : public QThreadPool
 {
-    for (const QRect &rect : region) {
+public:
+    QXcbFlushThreadPool()
+    {
+        // The GUI thread sends the converted chunks meanwhile
+        setMaxThreadCount(qBound(1, QThread::idealThreadCount() - 1, 3));
+    }
+};
+
+Q_GLOBAL_STATIC(QXcbFlushThreadPool, flushThreadPool)
+
+class QXcbConvertChunkTask : public QRunnable
+{
+public:
+    QXcbConvertChunkTask(QByteArray *buffer, int stride, const QImage *image, const QRect &rect,
+                         bool swap, QSemaphore *done)
+        : m_buffer(buffer), m_stride(stride), m_image(image), m_rect(rect), m_swap(swap), m_done(done)
+    {
+    }
+
+    void run() override
+    {
+        convert_sub_image(m_buffer, m_stride, *m_image, m_rect, m_swap);
+        m_done->release();
+    }
+
+private:
+    QByteArray *m_buffer;
+    int m_stride;
+    const QImage *m_image;
+    QRect m_rect;
+    bool m_swap;
+    QSemaphore *m_done;
+};
+
+void QXcbBackingStoreImage::forgetProcessedShmPuts()
+{
+    auto processed = [this](const PendingShmPut &put) {
+        return connection()->isRequestProcessed(put.sequence);
+    };
+    m_pendingShmPuts.erase(std::remove_if(m_pendingShmPuts.begin(), m_pendingShmPuts.end(), processed),
+                           m_pendingShmPuts.end());
+}
+
+void QXcbBackingStoreImage::waitForShm(const QRegion &region)
+{
+    // Forget about the puts the server is known to be done with
+    forgetProcessedShmPuts();
+
+    auto intersects = [&region](const PendingShmPut &put) {
+        return std::any_of(put.rects.cbegin(), put.rects.cend(),
+                           [&region](const QRect &rect) { return region.intersects(rect); });
+    };
+
+    // Requests are processed in order, so it's enough to wait for the last put
+    // that reads from the region we are about to overwrite.
+    for (int i = m_pendingShmPuts.size() - 1; i >= 0; --i) {
+        if (intersects(m_pendingShmPuts.at(i))) {
+            QElapsedTimer stallTimer;
+            stallTimer.start();
+            connection()->waitForRequest(m_pendingShmPuts.at(i).sequence);
+            countStall(stallTimer);
+            m_pendingShmPuts.remove(0, i + 1);
+            break;
+        }
+    }
+}
+
+void QXcbBackingStoreImage::shmPutImage(xcb_drawable_t drawable, const QVector<QRect> &rects, const QPoint &offset)
+{
+    if (rects.isEmpty())
+        return;
+
+    QVector<QRect> sourceRects;
+    sourceRects.reserve(rects.size());
+
+    xcb_void_cookie_t cookie;
+    for (int i = 0; i < rects.size(); ++i) {
+        const QRect &rect = rects.at(i);
         const QPoint source = rect.translated(offset).topLeft();
-        xcb_shm_put_image(xcb_connection(),
-                          drawable,
-                          m_gc,
-                          m_xcb_image->width,
-                          m_xcb_image->height,
-                          source.x(), source.y(),
-                          rect.width(), rect.height(),
-                          rect.x(), rect.y(),
-                          m_xcb_image->depth,
-                          m_xcb_image->format,
-                          0, // send event?
-                          m_shm_info.shmseg,
-                          m_xcb_image->data - m_shm_info.shmaddr);
+        // Only the last put asks for a completion event, which tells
+        // us that the server is done with all of them.
+        cookie = xcb_shm_put_image(xcb_connection(),
+                                   drawable,
+                                   m_gc,
+                                   m_xcb_image->width,
+                                   m_xcb_image->height,
+                                   source.x(), source.y(),
+                                   rect.width(), rect.height(),
+                                   rect.x(), rect.y(),
+                                   m_xcb_image->depth,
+                                   m_xcb_image->format,
+                                   i == rects.size() - 1, // send event?
+                                   m_shmBlock.shmseg,
+                                   m_shmBlock.offset);
+        countRequest(sizeof(xcb_shm_put_image_request_t));
+        sourceRects.append(rect.translated(offset));
     }
-    m_dirtyShm |= region.translated(offset);
+    m_pendingShmPuts.append({ sourceRects, cookie.sequence });
+}
+
+static QVector<QRect> regionRects(const QRegion &region)
+{
+    QVector<QRect> rects;
+    rects.reserve(region.rectCount());
+    for (const QRect &rect : region)
+        rects.append(rect);
+    return rects;
+}
+
+/*!
+    Returns the rects to upload for the damage within \a clip, leaving out
+    the scrolled region which only the server-side pixmap has up to date.
+*/
+QVector<QRect> QXcbBackingStoreImage::pendingFlushRects(const QRect &clip, int requestCost) const
+{
+    QVector<QRect> rects = m_pendingFlush.spans(clip & QRect(QPoint(), size()),
+                                                m_xcb_image->bpp / 8, requestCost);
+    if (m_scrolledRegion.isEmpty() || rects.isEmpty())
+        return rects;
+
+    QRegion region;
+    for (const QRect &rect : qAsConst(rects))
+        region |= rect;
+    region -= m_scrolledRegion;
+    return regionRects(region);
+}
+
+QVector<QRect> QXcbBackingStoreImage::uploadRects(const QRegion &region, int requestCost) const
+{
+    return QXcbDamageTiles::merged(regionRects(region), m_xcb_image->bpp / 8, requestCost);
 }
 
 void QXcbBackingStoreImage::flushPixmap(const QRegion &region, bool fullRegion)
 {
-    if (!fullRegion) {
-        auto actualRegion = m_pendingFlush.intersected(region);
-        m_pendingFlush -= region;
-        flushPixmap(actualRegion, true);
+    if (fullRegion) {
+        putPixmap(uploadRects(region, PutImageRequestCost));
         return;
     }
 
+    const QRect clip = region.boundingRect();
+    putPixmap(pendingFlushRects(clip, PutImageRequestCost));
+    m_pendingFlush.subtract(clip);
+}
+
+void QXcbBackingStoreImage::putPixmap(const QVector<QRect> &rects)
+{
+    if (rects.isEmpty())
+        return;
+
     xcb_image_t xcb_subimage;
     memset(&xcb_subimage, 0, sizeof(xcb_image_t));
 
@@ -591,9 +1149,36 @@ void QXcbBackingStoreImage::flushPixmap(const QRegion &region, bool fullRegion)
     // Ensure that we don't send more than maxPutImageRequestDataBytes per request.
     const auto maxPutImageRequestDataBytes = connection()->maxRequestDataBytes(sizeof(xcb_put_image_request_t));
 
-    for (const QRect &rect : region) {
-        const quint32 stride = round_up_scanline(rect.width() * m_qimage.depth(), xcb_subimage.scanline_pad) >> 3;
-        const int rows_per_put = maxPutImageRequestDataBytes / stride;
+    const QVector<QRect> sendRects = m_rowHashes.isEmpty() ? rects : changedRows(rects);
+
+    const int depth = m_qimage.depth();
+    auto strideFor = [&](const QRect &rect) -> quint32 {
+        return round_up_scanline(rect.width() * depth, xcb_subimage.scanline_pad) >> 3;
+    };
+
+    qint64 totalBytes = 0;
+    for (const QRect &rect : sendRects)
+        totalBytes += qint64(strideFor(rect)) * rect.height();
+    // Without byte swapping the rows are sent straight from the image, only
+    // swapped uploads need to be converted
+    const bool pipelined = needsByteSwap && totalBytes >= PipelinedFlushBytes
+            && QThread::idealThreadCount() > 1;
+    const quint32 maxChunkBytes = pipelined ? std::min<quint32>(maxPutImageRequestDataBytes, PipelinedChunkBytes)
+                                            : maxPutImageRequestDataBytes;
+
+    // If we upload the whole image in a single chunk, the result might be
+    // larger than the server's maximum request size and stuff breaks.
+    // To work around that, we upload the image in chunks where each chunk
+    // is small enough for a single request.
+    struct Chunk {
+        QRect rect;
+        quint32 stride;
+    };
+    QVector<Chunk> chunks;
+    for (const QRect &rect : sendRects) {
+        const quint32 stride = strideFor(rect);
+        const int rows_per_put = needsByteSwap ? maxChunkBytes / stride
+                                               : std::min<int>(maxChunkBytes / stride, MaxPutImageRows);
 
         // This assert could trigger if a single row has more pixels than fit in
         // a single PutImage request. In the absence of the BIG-REQUESTS extension
@@ -601,39 +1186,235 @@ void QXcbBackingStoreImage::flushPixmap(const QRegion &region, bool fullRegion)
         // roughly 256kB.
         Q_ASSERT(rows_per_put > 0);
 
-        // If we upload the whole image in a single chunk, the result might be
-        // larger than the server's maximum request size and stuff breaks.
-        // To work around that, we upload the image in chunks where each chunk
-        // is small enough for a single request.
-        const int x = rect.x();
-        int y = rect.y();
-        const int width = rect.width();
-        int height = rect.height();
+        for (int y = rect.y(); y <= rect.bottom(); y += rows_per_put) {
+            const int rows = std::min(rect.bottom() + 1 - y, rows_per_put);
+            chunks.append({ QRect(rect.x(), y, rect.width(), rows), stride });
+        }
+    }
+
+    auto putChunk = [&](const Chunk &chunk, const uchar *data) {
+        Q_ASSERT(size_t(chunk.stride) * chunk.rect.height() <= maxPutImageRequestDataBytes);
 
-        while (height > 0) {
-            const int rows = std::min(height, rows_per_put);
-            const QRect subRect(x, y, width, rows);
-            const QImage subImage = native_sub_image(&m_flushBuffer, stride, m_qimage, subRect, needsByteSwap);
+        xcb_subimage.width = chunk.rect.width();
+        xcb_subimage.height = chunk.rect.height();
+        xcb_subimage.data = const_cast<uint8_t *>(data);
+        xcb_image_annotate(&xcb_subimage);
 
-            Q_ASSERT(static_cast<size_t>(subImage.sizeInBytes()) <= maxPutImageRequestDataBytes);
+        xcb_image_put(xcb_connection(),
+                      m_xcb_pixmap,
+                      m_gc,
+                      &xcb_subimage,
+                      chunk.rect.x(),
+                      chunk.rect.y(),
+                      0);
+        countRequest(sizeof(xcb_put_image_request_t) + size_t(chunk.stride) * chunk.rect.height());
+    };
+
+    if (!pipelined || chunks.size() < 2) {
+        for (const Chunk &chunk : qAsConst(chunks)) {
+            if (!needsByteSwap && putImageRows(chunk.rect, chunk.stride))
+                continue;
+            const QImage subImage = native_sub_image(&m_flushBuffer, chunk.stride, m_qimage, chunk.rect, needsByteSwap);
+            putChunk(chunk, subImage.constBits());
+        }
+        return;
+    }
 
-            xcb_subimage.width = width;
-            xcb_subimage.height = rows;
-            xcb_subimage.data = const_cast<uint8_t *>(subImage.constBits());
-            xcb_image_annotate(&xcb_subimage);
+    // Convert up to StagingBufferCount chunks ahead on worker threads, and send
+    // them in order as they become ready. xcb_image_put() is done with the data
+    // when it returns, so the buffer can be reused right away.
+    QSemaphore converted[StagingBufferCount];
+    const int ringSize = std::min<int>(StagingBufferCount, chunks.size());
+    auto convertChunk = [&](int i) {
+        const int slot = i % ringSize;
+        flushThreadPool()->start(new QXcbConvertChunkTask(&m_stagingBuffers[slot], chunks.at(i).stride,
+                                                          &m_qimage, chunks.at(i).rect, needsByteSwap,
+                                                          &converted[slot]));
+    };
+
+    for (int i = 0; i < ringSize; ++i)
+        convertChunk(i);
+
+    for (int i = 0; i < chunks.size(); ++i) {
+        const int slot = i % ringSize;
+        converted[slot].acquire();
+        putChunk(chunks.at(i), reinterpret_cast<const uchar *>(m_stagingBuffers[slot].constData()));
+        if (i + ringSize < chunks.size())
+            convertChunk(i + ringSize);
+    }
+}
 
-            xcb_image_put(xcb_connection(),
-                          m_xcb_pixmap,
-                          m_gc,
-                          &xcb_subimage,
-                          x,
-                          y,
-                          0);
+static quint64 hashRow(const uchar *data, int length)
+{
+    quint64 h = Q_UINT64_C(0x9e3779b97f4a7c15) ^ quint64(length);
+    auto mix = [&h](quint64 word) {
+        h = (h ^ word) * Q_UINT64_C(0xff51afd7ed558ccd);
+        h ^= h >> 32;
+    };
+
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        quint64 word;
+        memcpy(&word, data + i, sizeof(word));
+        mix(word);
+    }
+    if (i < length) {
+        quint64 word = 0;
+        memcpy(&word, data + i, length - i);
+        mix(word);
+    }
+    return h;
+}
 
-            y += rows;
-            height -= rows;
+/*!
+    Returns the parts of \a rects whose rows differ from what was last
+    uploaded there, as runs of consecutive rows, and remembers the content
+    that is going to be uploaded.
+*/
+QVector<QRect> QXcbBackingStoreImage::changedRows(const QVector<QRect> &rects)
+{
+    QVector<QRect> changed;
+    const int bytesPerPixel = m_qimage.depth() >> 3;
+
+    for (const QRect &rect : rects) {
+        const int rowBytes = rect.width() * bytesPerPixel;
+        int runStart = -1;
+        for (int y = rect.top(); y <= rect.bottom() + 1; ++y) {
+            bool rowChanged = false;
+            if (y <= rect.bottom()) {
+                const quint64 hash = hashRow(m_qimage.constScanLine(y) + rect.x() * bytesPerPixel, rowBytes);
+                RowHash &row = m_rowHashes[y];
+                rowChanged = row.width != rect.width() || row.x != rect.x() || row.hash != hash;
+                if (rowChanged) {
+                    row.hash = hash;
+                    row.x = rect.x();
+                    row.width = rect.width();
+                    m_uploadedBytes += rowBytes;
+                } else {
+                    m_skippedBytes += rowBytes;
+                }
+            }
+
+            if (rowChanged && runStart < 0) {
+                runStart = y;
+            } else if (!rowChanged && runStart >= 0) {
+                changed.append(QRect(rect.x(), runStart, rect.width(), y - runStart));
+                runStart = -1;
+            }
         }
     }
+
+    reportRowHashing(false);
+    return changed;
+}
+
+void QXcbBackingStoreImage::invalidateRowHashes(const QRect &rect)
+{
+    if (m_rowHashes.isEmpty())
+        return;
+
+    const int bottom = qMin(rect.bottom(), m_rowHashes.size() - 1);
+    for (int y = qMax(rect.top(), 0); y <= bottom; ++y)
+        m_rowHashes[y].width = 0;
+}
+
+void QXcbBackingStoreImage::countRequest(size_t bytes)
+{
+    ++m_statistics.requests;
+    m_statistics.bytes += (bytes + 3) & ~size_t(3);
+}
+
+void QXcbBackingStoreImage::countStall(const QElapsedTimer &timer)
+{
+    ++m_statistics.stalls;
+    m_statistics.stallTimeUs += timer.nsecsElapsed() / 1000;
+}
+
+QXcbBackingStoreImage::Statistics QXcbBackingStoreImage::takeStatistics()
+{
+    const Statistics statistics = m_statistics;
+    m_statistics = Statistics();
+    return statistics;
+}
+
+/*!
+    Returns how the content gets to the server, for the statistics.
+*/
+const char *QXcbBackingStoreImage::uploadPath() const
+{
+    if (m_shmPixmap)
+        return "shm pixmap";
+    if (hasShm())
+        return "shm";
+    return m_xcb_image && m_xcb_image->byte_order != connection()->setup()->image_byte_order
+            ? "put image, byte swapped" : "put image";
+}
+
+void QXcbBackingStoreImage::reportRowHashing(bool force)
+{
+    if (m_uploadedBytes == 0 && m_skippedBytes == 0)
+        return;
+    if (!force && m_rowHashReportTimer.isValid() && !m_rowHashReportTimer.hasExpired(5000))
+        return;
+
+    qCDebug(lcQpaXcb) << "[" << m_backingStore->window() << "] uploaded" << m_uploadedBytes
+                      << "bytes, skipped" << m_skippedBytes << "bytes of unchanged rows";
+    m_rowHashReportTimer.start();
+}
+
+/*!
+    Sends a PutImage request for \a rect of the image with the data taken
+    directly from its scanlines, without copying them into a temporary
+    buffer first. Returns \c false if the rows can't be sent as they are.
+*/
+bool QXcbBackingStoreImage::putImageRows(const QRect &rect, quint32 stride)
+{
+    const qint64 srcBytesPerLine = m_qimage.bytesPerLine();
+    const int leftOffset = rect.x() * m_qimage.depth() >> 3;
+    const uchar *bits = m_qimage.constBits() + rect.y() * srcBytesPerLine + leftOffset;
+
+    // A band of full rows with the same stride is one block of memory
+    const bool contiguous = leftOffset == 0 && srcBytesPerLine == stride;
+
+    // Otherwise every row is sent including the padding up to the scanline
+    // pad, which must not reach past the image data.
+    if (!contiguous && rect.bottom() * srcBytesPerLine + leftOffset + stride > m_qimage.sizeInBytes())
+        return false;
+
+    xcb_put_image_request_t request;
+    memset(&request, 0, sizeof(request));
+    request.format = m_xcb_image->format;
+    request.drawable = m_xcb_pixmap;
+    request.gc = m_gc;
+    request.width = rect.width();
+    request.height = rect.height();
+    request.dst_x = rect.x();
+    request.dst_y = rect.y();
+    request.left_pad = 0;
+    request.depth = m_xcb_image->depth;
+
+    // xcb_send_request() needs two spare iovecs in front of the request
+    const int rows = contiguous ? 1 : rect.height();
+    QVarLengthArray<struct iovec, 64> parts(rows + 4);
+    parts[2].iov_base = &request;
+    parts[2].iov_len = sizeof(request);
+    for (int i = 0; i < rows; ++i) {
+        parts[3 + i].iov_base = const_cast<uchar *>(bits + i * srcBytesPerLine);
+        parts[3 + i].iov_len = contiguous ? size_t(stride) * rect.height() : stride;
+    }
+    const size_t dataBytes = size_t(stride) * rect.height();
+    parts[3 + rows].iov_base = nullptr; // libxcb fills in the padding
+    parts[3 + rows].iov_len = -dataBytes & 3;
+
+    xcb_protocol_request_t protocolRequest;
+    protocolRequest.count = rows + 2;
+    protocolRequest.ext = nullptr;
+    protocolRequest.opcode = XCB_PUT_IMAGE;
+    protocolRequest.isvoid = 1;
+
+    xcb_send_request(xcb_connection(), 0, parts.data() + 2, &protocolRequest);
+    countRequest(sizeof(request) + dataBytes);
+    return true;
 }
 
 void QXcbBackingStoreImage::setClip(const QRegion &region)
@@ -642,6 +1423,7 @@ void QXcbBackingStoreImage::setClip(const QRegion &region)
         static const uint32_t mask = XCB_GC_CLIP_MASK;
         static const uint32_t values[] = { XCB_NONE };
         xcb_change_gc(xcb_connection(), m_gc, mask, values);
+        countRequest(sizeof(xcb_change_gc_request_t) + sizeof(values));
     } else {
         const auto xcb_rects = qRegionToXcbRectangleList(region);
         xcb_set_clip_rectangles(xcb_connection(),
@@ -649,6 +1431,7 @@ void QXcbBackingStoreImage::setClip(const QRegion &region)
                                 m_gc,
                                 0, 0,
                                 xcb_rects.size(), xcb_rects.constData());
+        countRequest(sizeof(xcb_set_clip_rectangles_request_t) + xcb_rects.size() * sizeof(xcb_rectangle_t));
     }
 }
 
@@ -659,7 +1442,36 @@ void QXcbBackingStoreImage::put(xcb_drawable_t dst, const QRegion &region, const
     ensureGC(dst);
     setClip(region);
 
-    if (hasShm()) {
+    if (m_shmPixmap) {
+        // The pixmap is the image, copy straight from it to the window. The
+        // clip limits a single copy of the bounding rect to the region. With
+        // graphics exposures on, the server answers it with a NoExpose event
+        // (the source is a pixmap, so nothing can be obscured), which tells us
+        // when it is done reading the image, like an MIT-SHM completion event.
+        if (!region.isEmpty()) {
+            static const uint32_t mask = XCB_GC_GRAPHICS_EXPOSURES;
+            static const uint32_t exposures[] = { 1 };
+            static const uint32_t noExposures[] = { 0 };
+
+            const QRect bounds = region.boundingRect();
+            const QPoint source = bounds.translated(offset).topLeft();
+            xcb_change_gc(xcb_connection(), m_gc, mask, exposures);
+            const xcb_void_cookie_t cookie =
+                    xcb_copy_area(xcb_connection(),
+                                  m_xcb_pixmap,
+                                  dst,
+                                  m_gc,
+                                  source.x(), source.y(),
+                                  bounds.x(), bounds.y(),
+                                  bounds.width(), bounds.height());
+            xcb_change_gc(xcb_connection(), m_gc, mask, noExposures);
+            countRequest(sizeof(xcb_change_gc_request_t) + sizeof(exposures));
+            countRequest(sizeof(xcb_copy_area_request_t));
+            countRequest(sizeof(xcb_change_gc_request_t) + sizeof(noExposures));
+
+            m_pendingShmPuts.append({ regionRects(region.translated(offset)), cookie.sequence });
+        }
+    } else if (hasShm()) {
         // Copy scrolled area on server-side from pixmap to window
         const QRegion scrolledRegion = m_scrolledRegion.translated(-offset);
         for (const QRect &rect : scrolledRegion) {
@@ -671,11 +1483,15 @@ void QXcbBackingStoreImage::put(xcb_drawable_t dst, const QRegion &region, const
                           source.x(), source.y(),
                           rect.x(), rect.y(),
                           rect.width(), rect.height());
+            countRequest(sizeof(xcb_copy_area_request_t));
         }
 
-        // Copy non-scrolled image from client-side memory to server-side window
+        // Copy non-scrolled image from client-side memory to server-side window.
+        // Merged rects may reach into the scrolled area, keep them out of it.
         const QRegion notScrolledArea = region - scrolledRegion;
-        shmPutImage(dst, notScrolledArea, offset);
+        if (!scrolledRegion.isEmpty())
+            setClip(notScrolledArea);
+        shmPutImage(dst, uploadRects(notScrolledArea, ShmPutRequestCost), offset);
     } else {
         const QRect bounds = region.boundingRect();
         const QPoint target = bounds.topLeft();
@@ -688,22 +1504,147 @@ void QXcbBackingStoreImage::put(xcb_drawable_t dst, const QRegion &region, const
                       source.x(), source.y(),
                       target.x(), target.y(),
                       source.width(), source.height());
+        countRequest(sizeof(xcb_copy_area_request_t));
     }
 
     setClip(QRegion());
 }
 
+/*!
+    Presents \a region of the window from the server-side pixmap, which is
+    first brought up to date. The server shows the content at the next
+    vertical blank and reports back with the \a serial once it is done.
+*/
+void QXcbBackingStoreImage::present(xcb_window_t window, const QRegion &region, const QPoint &offset, uint32_t serial)
+{
+    Q_ASSERT(!m_clientSideScroll);
+    waitForFlush();
+
+    ensureGC(window);
+
+    const QRegion sourceRegion = region.translated(offset);
+    if (!m_shmPixmap) {
+        // Don't overwrite the pixmap while the previous frame is read from it
+        waitForPresentIdle();
+
+        const QRect clip = sourceRegion.boundingRect();
+        if (hasShm())
+            shmPutImage(m_xcb_pixmap, pendingFlushRects(clip, ShmPutRequestCost));
+        else
+            putPixmap(pendingFlushRects(clip, PutImageRequestCost));
+        m_pendingFlush.subtract(clip);
+    }
+
+    const auto xcb_rects = qRegionToXcbRectangleList(sourceRegion);
+    const xcb_xfixes_region_t update = xcb_generate_id(xcb_connection());
+    xcb_xfixes_create_region(xcb_connection(), update, xcb_rects.size(), xcb_rects.constData());
+    countRequest(sizeof(xcb_xfixes_create_region_request_t) + xcb_rects.size() * sizeof(xcb_rectangle_t));
+
+    xcb_present_pixmap(xcb_connection(),
+                       window,
+                       m_xcb_pixmap,
+                       serial,
+                       XCB_NONE, // valid
+                       update,
+                       -offset.x(), -offset.y(),
+                       XCB_NONE, // target crtc
+                       XCB_NONE, // wait fence
+                       XCB_NONE, // idle fence
+                       XCB_PRESENT_OPTION_NONE,
+                       0, 0, 0, // next vertical blank
+                       0, nullptr);
+    countRequest(sizeof(xcb_present_pixmap_request_t));
+
+    xcb_xfixes_destroy_region(xcb_connection(), update);
+    countRequest(sizeof(xcb_xfixes_destroy_region_request_t));
+
+    m_presentSerial = serial;
+    m_presentPending = true;
+}
+
+void QXcbBackingStoreImage::handlePresentIdle(xcb_pixmap_t pixmap, uint32_t serial)
+{
+    if (pixmap == m_xcb_pixmap && serial == m_presentSerial)
+        m_presentPending = false;
+}
+
+void QXcbBackingStoreImage::waitForPresentIdle()
+{
+    if (!m_presentPending)
+        return;
+
+    QElapsedTimer stallTimer;
+    stallTimer.start();
+    if (!connection()->waitForPresentIdle(m_xcb_pixmap, m_presentSerial))
+        qCDebug(lcQpaXcb) << "[" << m_backingStore->window() << "] timed out waiting for the presented pixmap";
+    countStall(stallTimer);
+    m_presentPending = false;
+}
+
+void QXcbBackingStoreImage::waitForFlush()
+{
+    if (!m_flushTicket)
+        return;
+
+    QXcbFlusher *flusher = connection()->flusher();
+    if (flusher->isDone(m_flushTicket)) {
+        flusher->waitFor(m_flushTicket);
+    } else {
+        QElapsedTimer stallTimer;
+        stallTimer.start();
+        flusher->waitFor(m_flushTicket);
+        countStall(stallTimer);
+    }
+    m_flushTicket = 0;
+}
+
 void QXcbBackingStoreImage::preparePaint(const QRegion &region)
 {
+    waitForFlush();
+
     if (hasShm()) {
         // to prevent X from reading from the image region while we're writing to it
-        if (m_dirtyShm.intersects(region)) {
-            connection()->sync();
-            m_dirtyShm = QRegion();
-        }
+        waitForShm(region);
     }
+    // A shared pixmap is the image, which the server may still be presenting
+    if (m_shmPixmap)
+        waitForPresentIdle();
     m_scrolledRegion -= region;
-    m_pendingFlush |= region;
+    if (!m_shmPixmap)
+        m_pendingFlush.add(region);
+}
+
+/*!
+    Returns whether the flusher or the server may still be reading from the image.
+*/
+bool QXcbBackingStoreImage::isBusy()
+{
+    if (m_flushTicket && !connection()->flusher()->isDone(m_flushTicket))
+        return true;
+    waitForFlush();
+
+    forgetProcessedShmPuts();
+    return !m_pendingShmPuts.isEmpty() || m_presentPending;
+}
+
+/*!
+    Copies \a region of \a other, which has the same size and format,
+    into this image.
+*/
+void QXcbBackingStoreImage::copyFrom(const QXcbBackingStoreImage &other, const QRegion &region)
+{
+    Q_ASSERT(other.m_qimage.size() == m_qimage.size() && other.m_qimage.format() == m_qimage.format());
+
+    preparePaint(region);
+
+    const int bytesPerPixel = m_qimage.depth() >> 3;
+    for (const QRect &rect : region) {
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            memcpy(m_qimage.scanLine(y) + rect.x() * bytesPerPixel,
+                   other.m_qimage.constScanLine(y) + rect.x() * bytesPerPixel,
+                   rect.width() * bytesPerPixel);
+        }
+    }
 }
 
 bool QXcbBackingStore::createSystemVShmSegment(xcb_connection_t *c, size_t segmentSize, void *shmInfo)
@@ -712,20 +1653,60 @@ bool QXcbBackingStore::createSystemVShmSegment(xcb_connection_t *c, size_t segme
     return QXcbBackingStoreImage::createSystemVShmSegment(c, segmentSize, info);
 }
 
+bool QXcbBackingStore::createMemfdShmSegment(xcb_connection_t *c, size_t segmentSize, void *shmInfo,
+                                             bool hugePages)
+{
+    auto info = reinterpret_cast<xcb_shm_segment_info_t *>(shmInfo);
+    return QXcbBackingStoreImage::createMemfdShmSegment(c, segmentSize, info, hugePages);
+}
+
 QXcbBackingStore::QXcbBackingStore(QWindow *window)
     : QPlatformBackingStore(window)
 {
     QXcbScreen *screen = static_cast<QXcbScreen *>(window->screen()->handle());
     setConnection(screen->connection());
+
+    static const bool presentRequested = qEnvironmentVariableIsSet("QT_XCB_PRESENT");
+    m_usePresent = presentRequested && connection()->hasPresent() && connection()->hasXFixes();
+
+    static const bool flushThreadRequested = qEnvironmentVariableIsSet("QT_XCB_FLUSH_THREAD");
+    m_useFlusher = flushThreadRequested;
+
+    // Once an interactive resize has settled, give back the headroom
+    // that was allocated to absorb it.
+    m_compactTimer.setSingleShot(true);
+    m_compactTimer.setInterval(500);
+    m_compactTimer.callOnTimeout([this]() {
+        for (const Buffer &buffer : qAsConst(m_buffers))
+            buffer.image->compact();
+    });
+
+    static const int reclaimDelay = qEnvironmentVariableIntValue("QT_XCB_BACKINGSTORE_RECLAIM_DELAY");
+    if (reclaimDelay > 0) {
+        m_reclaimTimer.setInterval(reclaimDelay * 1000);
+        m_reclaimTimer.callOnTimeout([this]() { checkReclaim(); });
+    }
+
+    connection()->memoryPressure()->addTrimmer("backing stores", this);
 }
 
 QXcbBackingStore::~QXcbBackingStore()
 {
-    delete m_image;
+    connection()->memoryPressure()->removeTrimmer(this);
+    waitForFlush();
+    if (m_image)
+        reportStatistics(true);
+
+    if (m_presentEventId)
+        connection()->removePresentEventListener(m_presentEventId);
+
+    for (const Buffer &buffer : qAsConst(m_buffers))
+        delete buffer.image;
 }
 
 QPaintDevice *QXcbBackingStore::paintDevice()
 {
+    restoreImage();
     if (!m_image)
         return nullptr;
     return m_rgbImage.isNull() ? m_image->image() : &m_rgbImage;
@@ -733,9 +1714,13 @@ QPaintDevice *QXcbBackingStore::paintDevice()
 
 void QXcbBackingStore::beginPaint(const QRegion &region)
 {
+    restoreImage();
     if (!m_image)
         return;
 
+    if (m_buffers.size() > 1 && m_paintRegions.isEmpty())
+        selectBuffer(region);
+
     m_paintRegions.push(region);
     m_image->preparePaint(region);
 
@@ -758,6 +1743,12 @@ void QXcbBackingStore::endPaint()
     const QRegion region = m_paintRegions.pop();
     m_image->preparePaint(region);
 
+    // The other buffers are now behind by what was painted
+    for (Buffer &buffer : m_buffers) {
+        if (buffer.image != m_image)
+            buffer.stale |= region;
+    }
+
     QXcbWindow *platformWindow = static_cast<QXcbWindow *>(window()->handle());
     if (!platformWindow || !platformWindow->imageNeedsRgbSwap())
         return;
@@ -768,7 +1759,24 @@ void QXcbBackingStore::endPaint()
     const auto end = region.end();
     if (it == end)
         return;
-    QPainter p(m_image->image());
+
+    QImage *image = m_image->image();
+    const QRect bounds = image->rect() & m_rgbImage.rect();
+    if (image->format() == m_rgbImage.format() && qt_xcb_canSwapRedBlue(image->format())) {
+        // Swap straight from one image into the other, row by row
+        const int bytesPerPixel = image->depth() / 8;
+        while (it != end) {
+            const QRect rect = *(it++) & bounds;
+            for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                const uchar *src = m_rgbImage.constScanLine(y) + rect.left() * bytesPerPixel;
+                uchar *dst = image->scanLine(y) + rect.left() * bytesPerPixel;
+                qt_xcb_swapRedBlue(image->format(), dst, src, rect.width());
+            }
+        }
+        return;
+    }
+
+    QPainter p(image);
     while (it != end) {
         const QRect rect = *(it++);
         p.drawImage(rect.topLeft(), m_rgbImage.copy(rect).rgbSwapped());
@@ -777,6 +1785,8 @@ void QXcbBackingStore::endPaint()
 
 QImage QXcbBackingStore::toImage() const
 {
+    const_cast<QXcbBackingStore *>(this)->restoreImage();
+
     // If the backingstore is rgbSwapped, return the internal image type here.
     if (!m_rgbImage.isNull())
         return m_rgbImage;
@@ -785,14 +1795,37 @@ QImage QXcbBackingStore::toImage() const
 
 QPlatformGraphicsBuffer *QXcbBackingStore::graphicsBuffer() const
 {
+    const_cast<QXcbBackingStore *>(this)->restoreImage();
+
     return m_image ? m_image->graphicsBuffer() : nullptr;
 }
 
 void QXcbBackingStore::flush(QWindow *window, const QRegion &region, const QPoint &offset)
 {
+    QXcbWindow *platformWindow = static_cast<QXcbWindow *>(window->handle());
+    if (!platformWindow) {
+        qCWarning(lcQpaXcb, "%s QWindow has no platform window, see QTBUG-32681", Q_FUNC_INFO);
+        return;
+    }
+
+    // Frames of the window are sent, and reported to the compositor, in order
+    waitForFlush();
+
+    // Nobody would see it. The window gets exposed, and flushed in full,
+    // once it can be seen again. Checked before the buffers of a window
+    // that has been hidden for a while are brought back for nothing.
+    if (!platformWindow->isExposed()) {
+        if (platformWindow->needsSync())
+            platformWindow->updateSyncRequestCounter();
+        return;
+    }
+
+    restoreImage();
     if (!m_image || m_image->size().isEmpty())
         return;
 
+    reportStatistics(false);
+
     m_image->flushScrolledRegion(false);
 
     QSize imageSize = m_image->size();
@@ -806,13 +1839,23 @@ void QXcbBackingStore::flush(QWindow *window, const QRegion &region, const QPoin
     if (bounds.isNull())
         return;
 
-    QXcbWindow *platformWindow = static_cast<QXcbWindow *>(window->handle());
-    if (!platformWindow) {
-        qCWarning(lcQpaXcb, "%s QWindow has no platform window, see QTBUG-32681", Q_FUNC_INFO);
+    if (m_flushCount++ == 0)
+        m_statisticsTimer.start();
+
+    platformWindow->beginFrame();
+    // Native child windows are not worth a Present event selection each
+    if (m_usePresent && window == this->window()) {
+        // A deferred frame is ended, and the sync request answered, once it
+        // is presented from handlePresentCompleteNotify()
+        if (!present(platformWindow, clipped, offset))
+            return;
+    } else if (m_useFlusher) {
+        queueRender(platformWindow, clipped, offset);
         return;
+    } else {
+        render(platformWindow->xcb_window(), clipped, offset);
     }
-
-    render(platformWindow->xcb_window(), clipped, offset);
+    platformWindow->endFrame();
 
     if (platformWindow->needsSync())
         platformWindow->updateSyncRequestCounter();
@@ -825,19 +1868,191 @@ void QXcbBackingStore::render(xcb_window_t window, const QRegion &region, const
     m_image->put(window, region, offset);
 }
 
+/*!
+    Has the flusher thread send \a region of the image to the window, and
+    ends the frame once it is done. The image is left alone until then.
+*/
+void QXcbBackingStore::queueRender(QXcbWindow *win, const QRegion &region, const QPoint &offset)
+{
+    QXcbBackingStoreImage *image = m_image;
+    const xcb_window_t xcbWindow = win->xcb_window();
+    const QPointer<QWindow> window = win->window();
+
+    auto work = [image, xcbWindow, region, offset]() {
+        image->put(xcbWindow, region, offset);
+    };
+    auto completion = [window, xcbWindow]() {
+        // The platform window may have been recreated meanwhile
+        auto *platformWindow = window ? static_cast<QXcbWindow *>(window->handle()) : nullptr;
+        if (!platformWindow || platformWindow->xcb_window() != xcbWindow)
+            return;
+        platformWindow->endFrame();
+        if (platformWindow->needsSync())
+            platformWindow->updateSyncRequestCounter();
+        else
+            platformWindow->connection()->flush();
+    };
+
+    m_flushTicket = connection()->flusher()->enqueue(work, completion);
+    image->setFlushTicket(m_flushTicket);
+}
+
+/*!
+    Waits for the last flush queued with queueRender(), and answers what it
+    was flushed for.
+*/
+void QXcbBackingStore::waitForFlush()
+{
+    if (!m_flushTicket)
+        return;
+
+    connection()->flusher()->waitFor(m_flushTicket);
+    m_flushTicket = 0;
+}
+
+/*!
+    Reports the rate of flushes since the last report, what they cost in
+    requests and bytes sent to the server, and how often and how long
+    painting or flushing had to wait for the server or the flusher thread.
+*/
+void QXcbBackingStore::reportStatistics(bool force)
+{
+    if (m_flushCount == 0)
+        return;
+    if (!force && !m_statisticsTimer.hasExpired(5000))
+        return;
+
+    QXcbBackingStoreImage::Statistics total;
+    for (const Buffer &buffer : qAsConst(m_buffers)) {
+        const QXcbBackingStoreImage::Statistics statistics = buffer.image->takeStatistics();
+        total.requests += statistics.requests;
+        total.bytes += statistics.bytes;
+        total.stalls += statistics.stalls;
+        total.stallTimeUs += statistics.stallTimeUs;
+    }
+
+    const qint64 elapsedMs = qMax<qint64>(1, m_statisticsTimer.elapsed());
+    qCDebug(lcQpaXcbBackingStore) << "[" << window() << "]" << m_image->uploadPath()
+                                  << "depth" << m_image->image()->depth() << ":"
+                                  << m_flushCount << "flushes," << m_flushCount * 1000.0 / elapsedMs << "per second,"
+                                  << qreal(total.requests) / m_flushCount << "requests and"
+                                  << total.bytes / m_flushCount << "bytes per flush,"
+                                  << total.stalls << "stalls taking" << total.stallTimeUs << "us";
+    m_flushCount = 0;
+    m_statisticsTimer.start();
+}
+
+/*!
+    Presents \a region of the window, or returns false if it has to wait for
+    the frame in flight and is deferred until that one is shown.
+*/
+bool QXcbBackingStore::present(QXcbWindow *win, const QRegion &region, const QPoint &offset)
+{
+    const xcb_window_t xcbWindow = win->xcb_window();
+    if (m_presentWindow != xcbWindow) {
+        // First flush, or the platform window was recreated
+        if (m_presentEventId)
+            connection()->removePresentEventListener(m_presentEventId);
+        m_presentEventId = xcb_generate_id(xcb_connection());
+        xcb_present_select_input(xcb_connection(), m_presentEventId, xcbWindow,
+                                 XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY
+                                 | XCB_PRESENT_EVENT_MASK_IDLE_NOTIFY);
+        connection()->addPresentEventListener(m_presentEventId, this);
+        m_presentWindow = xcbWindow;
+        m_presentInFlight = false;
+        m_deferredPresent = QRegion();
+    }
+
+    // Don't queue up frames behind the one waiting for the vertical blank,
+    // unless its completion got lost (e.g. the window was unmapped)
+    if (m_presentInFlight && !m_presentTimer.hasExpired(100)) {
+        if (m_deferredPresent.isEmpty() || offset == m_deferredOffset) {
+            m_deferredPresent |= region;
+            m_deferredOffset = offset;
+            return false;
+        }
+        // The offset of the top-level window doesn't change in practice,
+        // but don't merge regions which don't match up
+        render(xcbWindow, region, offset);
+        return true;
+    }
+
+    const QRegion presentRegion = m_deferredPresent.isEmpty() || offset != m_deferredOffset
+            ? region : region | m_deferredPresent;
+    m_deferredPresent = QRegion();
+
+    m_image->present(xcbWindow, presentRegion, offset, ++m_presentSerial);
+    m_presentInFlight = true;
+    m_presentTimer.start();
+    return true;
+}
+
+void QXcbBackingStore::handlePresentCompleteNotify(const xcb_present_complete_notify_event_t *event)
+{
+    if (event->kind != XCB_PRESENT_COMPLETE_KIND_PIXMAP || event->serial != m_presentSerial)
+        return;
+
+    qCDebug(lcQpaXcb) << "[" << window() << "] frame" << event->serial << "presented at msc"
+                      << event->msc << "ust" << event->ust << "mode" << int(event->mode);
+    m_presentInFlight = false;
+
+    QXcbWindow *platformWindow = static_cast<QXcbWindow *>(window()->handle());
+    // Present reports in microseconds of the monotonic clock
+    if (platformWindow && platformWindow->xcbScreen())
+        platformWindow->xcbScreen()->frameClock()->frameShown(qint64(event->ust) * 1000);
+
+    if (m_deferredPresent.isEmpty() || !m_image || m_image->size().isEmpty())
+        return;
+
+    if (!platformWindow || platformWindow->xcb_window() != m_presentWindow) {
+        m_deferredPresent = QRegion();
+        return;
+    }
+
+    const QRegion region = m_deferredPresent;
+    m_deferredPresent = QRegion();
+    m_image->flushScrolledRegion(false);
+    platformWindow->beginFrame();
+    present(platformWindow, region, m_deferredOffset);
+    platformWindow->endFrame();
+
+    if (platformWindow->needsSync())
+        platformWindow->updateSyncRequestCounter();
+    else
+        xcb_flush(xcb_connection());
+}
+
+void QXcbBackingStore::handlePresentIdleNotify(const xcb_present_idle_notify_event_t *event)
+{
+    for (const Buffer &buffer : qAsConst(m_buffers))
+        buffer.image->handlePresentIdle(event->pixmap, event->serial);
+}
+
 #ifndef QT_NO_OPENGL
 void QXcbBackingStore::composeAndFlush(QWindow *window, const QRegion &region, const QPoint &offset,
                                        QPlatformTextureList *textures,
                                        bool translucentBackground)
 {
+    QXcbWindow *platformWindow = static_cast<QXcbWindow *>(window->handle());
+    waitForFlush();
+
+    // Like in flush(), don't bring back the buffers of a hidden window
+    if (!platformWindow->isExposed()) {
+        if (platformWindow->needsSync())
+            platformWindow->updateSyncRequestCounter();
+        return;
+    }
+
+    restoreImage();
     if (!m_image || m_image->size().isEmpty())
         return;
 
     m_image->flushScrolledRegion(true);
 
+    platformWindow->beginFrame();
     QPlatformBackingStore::composeAndFlush(window, region, offset, textures, translucentBackground);
+    platformWindow->endFrame();
 
-    QXcbWindow *platformWindow = static_cast<QXcbWindow *>(window->handle());
     if (platformWindow->needsSync()) {
         platformWindow->updateSyncRequestCounter();
     } else {
@@ -848,6 +2063,7 @@ void QXcbBackingStore::composeAndFlush(QWindow *window, const QRegion &region, c
 
 void QXcbBackingStore::resize(const QSize &size, const QRegion &)
 {
+    restoreImage();
     if (m_image && size == m_image->size())
         return;
 
@@ -861,22 +2077,203 @@ void QXcbBackingStore::resize(const QSize &size, const QRegion &)
     recreateImage(win, size);
 }
 
+bool QXcbBackingStore::isLiveResize(QXcbWindow *win) const
+{
+    // A window manager doing an interactive resize either asks us to
+    // synchronize with it, or sends size changes in quick succession.
+    if (win->needsSync())
+        return true;
+    return m_lastResize.isValid() && !m_lastResize.hasExpired(250);
+}
+
+static int backingStoreBufferCount()
+{
+    static const int count = qBound(1, qEnvironmentVariableIntValue("QT_XCB_BACKINGSTORE_BUFFERS"), 3);
+    return count;
+}
+
 void QXcbBackingStore::recreateImage(QXcbWindow *win, const QSize &size)
 {
-    if (m_image)
-        m_image->resize(size);
-    else
+    if (m_image) {
+        const bool liveResize = isLiveResize(win);
+        for (Buffer &buffer : m_buffers) {
+            buffer.image->resize(size, liveResize);
+            // Only newly exposed areas may get repainted, e.g. with static
+            // contents, so the other buffers have to be brought up to date
+            // from the current one in full
+            buffer.stale = buffer.image == m_image ? QRegion() : QRegion(QRect(QPoint(), size));
+            buffer.age = 0;
+        }
+        if (liveResize)
+            m_compactTimer.start();
+    } else {
         m_image = new QXcbBackingStoreImage(this, size);
+        m_buffers.append({ m_image, QRegion(), 0 });
+
+        // Additional buffers only help when flushing doesn't copy the image
+        if (m_image->hasShm()) {
+            for (int i = 1; i < backingStoreBufferCount(); ++i)
+                m_buffers.append({ new QXcbBackingStoreImage(this, size), QRegion(), 0 });
+        }
+    }
+    m_lastResize.start();
+    if (m_reclaimTimer.interval() > 0)
+        m_reclaimTimer.start();
 
     // Slow path for bgr888 VNC: Create an additional image, paint into that and
-    // swap R and B while copying to m_image after each paint.
+    // swap R and B while copying to m_image after each paint. Use the format
+    // of m_image, which may have been given an alpha channel, so that the
+    // rows can be swapped straight across.
     if (win->imageNeedsRgbSwap()) {
-        m_rgbImage = QImage(size, win->imageFormat());
+        m_rgbImage = QImage(size, m_image->image()->format());
+    }
+}
+
+/*!
+    Makes the buffer which has been unused for longest and which the server
+    is done reading from current, and brings it up to date with the content
+    of the previous buffer outside \a paintRegion. Stays with the current
+    buffer if all others are busy.
+*/
+void QXcbBackingStore::selectBuffer(const QRegion &paintRegion)
+{
+    Buffer *next = nullptr;
+    for (Buffer &buffer : m_buffers) {
+        if (buffer.image != m_image && (!next || buffer.age > next->age) && !buffer.image->isBusy())
+            next = &buffer;
+    }
+
+    for (Buffer &buffer : m_buffers)
+        ++buffer.age;
+    if (!next) {
+        qCDebug(lcQpaXcb) << "[" << window() << "] all back buffers busy, painting into the front buffer";
+        for (Buffer &buffer : m_buffers) {
+            if (buffer.image == m_image)
+                buffer.age = 0;
+        }
+        return;
+    }
+
+    qCDebug(lcQpaXcb) << "[" << window() << "] painting into buffer of age" << next->age;
+    const QRegion stale = next->stale - paintRegion;
+    if (!stale.isEmpty())
+        next->image->copyFrom(*m_image, stale);
+    next->stale = QRegion();
+    next->age = 0;
+    m_image = next->image;
+}
+
+/*!
+    Frees the buffers once the window couldn't be seen at two checks in a
+    row, i.e. for at least the reclaim delay.
+*/
+void QXcbBackingStore::checkReclaim()
+{
+    if (!m_image || m_image->isReleased()) {
+        m_reclaimTimer.stop();
+        return;
+    }
+
+    QXcbWindow *platformWindow = static_cast<QXcbWindow *>(window()->handle());
+    if (platformWindow && platformWindow->isExposed()) {
+        m_hiddenSince.invalidate();
+        return;
+    }
+    if (!m_hiddenSince.isValid()) {
+        m_hiddenSince.start();
+        return;
     }
+
+    // Painting goes to the image directly, which can't be restored
+    // behind its back
+    if (!m_paintRegions.isEmpty() || !m_rgbImage.isNull())
+        return;
+
+    reclaim();
+}
+
+qint64 QXcbBackingStore::reclaim()
+{
+    // Only heap buffers are freed right away, SHM blocks go back to the arena
+    qint64 releasedBytes = 0;
+    bool releasedShm = false;
+    for (const Buffer &buffer : qAsConst(m_buffers)) {
+        if (buffer.image->hasShm())
+            releasedShm = true;
+        else if (buffer.image->image())
+            releasedBytes += buffer.image->image()->sizeInBytes();
+    }
+
+    // Only the current buffer needs its content, the others are
+    // brought up to date from it
+    for (const Buffer &buffer : qAsConst(m_buffers)) {
+        const QByteArray snapshot = buffer.image->release(buffer.image == m_image);
+        if (buffer.image == m_image)
+            m_snapshot = snapshot;
+    }
+    m_reclaimTimer.stop();
+    m_hiddenSince.invalidate();
+
+    // The arena keeps idle segments around to be reused, which a window that
+    // can't be seen won't do any time soon
+    if (releasedShm)
+        releasedBytes += qint64(connection()->shmArena()->trim(0));
+
+    qCDebug(lcQpaXcb) << "[" << window() << "] released" << releasedBytes
+                      << "bytes of buffers, keeping a snapshot of" << m_snapshot.size() << "bytes";
+    return releasedBytes - m_snapshot.size();
+}
+
+/*!
+    Frees the buffers of a window which can't be seen, like after the
+    reclaim delay, and otherwise the headroom and temporary buffers.
+*/
+qint64 QXcbBackingStore::trimMemory()
+{
+    if (!m_image || m_image->isReleased())
+        return 0;
+
+    QXcbWindow *platformWindow = static_cast<QXcbWindow *>(window()->handle());
+    const bool exposed = platformWindow && platformWindow->isExposed();
+    if (!exposed && m_paintRegions.isEmpty() && m_rgbImage.isNull())
+        return reclaim();
+
+    qint64 releasedBytes = 0;
+    for (const Buffer &buffer : qAsConst(m_buffers)) {
+        releasedBytes += buffer.image->releaseTemporaryBuffers();
+        if (m_paintRegions.isEmpty())
+            releasedBytes += buffer.image->compact();
+    }
+    return releasedBytes;
+}
+
+void QXcbBackingStore::restoreImage()
+{
+    if (!m_image || !m_image->isReleased())
+        return;
+
+    for (const Buffer &buffer : qAsConst(m_buffers))
+        buffer.image->restore(buffer.image == m_image ? m_snapshot : QByteArray());
+    m_snapshot.clear();
+
+    for (Buffer &buffer : m_buffers) {
+        buffer.stale = buffer.image == m_image ? QRegion() : QRegion(QRect(QPoint(), m_image->size()));
+        buffer.age = 0;
+    }
+
+    if (m_reclaimTimer.interval() > 0)
+        m_reclaimTimer.start();
 }
 
 bool QXcbBackingStore::scroll(const QRegion &area, int dx, int dy)
 {
+    restoreImage();
+
+    // The other buffers would need to be scrolled too, have the area
+    // repainted instead.
+    if (m_buffers.size() > 1)
+        return false;
+
     if (m_image)
         return m_image->scroll(area, dx, dy);
 
@@ -42,16 +42,22 @@
 
 #include <qpa/qplatformbackingstore.h>
 #include <QtCore/QStack>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QTimer>
+#include <QtCore/QVector>
+#include <QtGui/QRegion>
 
 #include <xcb/xcb.h>
 
 #include "qxcbobject.h"
+#include "qxcbmemorypressure.h"
 
 QT_BEGIN_NAMESPACE
 
 class QXcbBackingStoreImage;
 
-class QXcbBackingStore : public QXcbObject, public QPlatformBackingStore
+class QXcbBackingStore : public QXcbObject, public QPlatformBackingStore, public QXcbPresentEventListener,
+                         public QXcbMemoryTrimmer
 {
 public:
     QXcbBackingStore(QWindow *window);
@@ -74,8 +80,15 @@ public:
     void beginPaint(const QRegion &) override;
     void endPaint() override;
 
+    void handlePresentCompleteNotify(const xcb_present_complete_notify_event_t *event) override;
+    void handlePresentIdleNotify(const xcb_present_idle_notify_event_t *event) override;
+
+    qint64 trimMemory() override;
+
     static bool createSystemVShmSegment(xcb_connection_t *c, size_t segmentSize = 1,
                                         void *shmInfo = nullptr);
+    static bool createMemfdShmSegment(xcb_connection_t *c, size_t segmentSize = 1,
+                                      void *shmInfo = nullptr, bool hugePages = false);
 
 protected:
     virtual void render(xcb_window_t window, const QRegion &region, const QPoint &offset);
@@ -84,6 +97,57 @@ protected:
     QXcbBackingStoreImage *m_image = nullptr;
     QStack<QRegion> m_paintRegions;
     QImage m_rgbImage;
+
+private:
+    bool isLiveResize(QXcbWindow *win) const;
+    void selectBuffer(const QRegion &paintRegion);
+    bool present(QXcbWindow *win, const QRegion &region, const QPoint &offset);
+    void queueRender(QXcbWindow *win, const QRegion &region, const QPoint &offset);
+    void waitForFlush();
+    void reportStatistics(bool force);
+    void checkReclaim();
+    qint64 reclaim();
+    void restoreImage();
+
+    // With QT_XCB_BACKINGSTORE_BUFFERS set to 2 or 3, the images painted into
+    // in turn, each with the region painted into the others since it was used
+    struct Buffer {
+        QXcbBackingStoreImage *image;
+        QRegion stale;
+        int age;
+    };
+    QVector<Buffer> m_buffers;
+
+    // With QT_XCB_PRESENT set, flushes of the top-level window are presented at
+    // the next vertical blank, and those made while a frame is pending are
+    // merged into the one that follows it
+    bool m_usePresent = false;
+    uint32_t m_presentEventId = 0;
+    xcb_window_t m_presentWindow = XCB_NONE;
+    uint32_t m_presentSerial = 0;
+    bool m_presentInFlight = false;
+    QElapsedTimer m_presentTimer;
+    QRegion m_deferredPresent;
+    QPoint m_deferredOffset;
+
+    // With QT_XCB_BACKINGSTORE_RECLAIM_DELAY set, the memory of the buffers is
+    // freed once the window couldn't be seen for that many seconds, keeping
+    // only a compressed snapshot of the content until the next paint or flush
+    QTimer m_reclaimTimer;
+    QElapsedTimer m_hiddenSince;
+    QByteArray m_snapshot;
+
+    // With QT_XCB_FLUSH_THREAD set, flushes are sent by the connection's
+    // flusher thread, one at a time, and this is the ticket of the last one
+    bool m_useFlusher = false;
+    quint64 m_flushTicket = 0;
+
+    // Flushes since the statistics were last reported with qt.qpa.xcb.backingstore
+    int m_flushCount = 0;
+    QElapsedTimer m_statisticsTimer;
+
+    QElapsedTimer m_lastResize;
+    QTimer m_compactTimer;
 };
 
 QT_END_NAMESPACE
@@ -0,0 +1,199 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qxcbbyteswap.h"
+
+#include <QtCore/QtEndian>
+#include <QtCore/private/qsimd_p.h>
+
+QT_BEGIN_NAMESPACE
+
+#if QT_COMPILER_SUPPORTS_HERE(AVX2)
+QT_FUNCTION_TARGET(AVX2)
+static int byteSwap_avx2(uchar *dst, const uchar *src, int bytes, int pixelSize)
+{
+    const __m256i shuffle = pixelSize == 4
+            ? _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                               3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)
+            : _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                               1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    int i = 0;
+    for (; i + 32 <= bytes; i += 32) {
+        const __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_shuffle_epi8(p, shuffle));
+    }
+    return i;
+}
+#endif
+
+#if QT_COMPILER_SUPPORTS_HERE(SSSE3)
+QT_FUNCTION_TARGET(SSSE3)
+static int byteSwap_ssse3(uchar *dst, const uchar *src, int bytes, int pixelSize)
+{
+    const __m128i shuffle = pixelSize == 4
+            ? _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)
+            : _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    int i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_shuffle_epi8(p, shuffle));
+    }
+    return i;
+}
+#endif
+
+#if defined(__SSE2__)
+static int byteSwap_sse2(uchar *dst, const uchar *src, int bytes, int pixelSize)
+{
+    int i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        // Swap the 16-bit halves of 32-bit pixels, then the bytes of each half
+        if (pixelSize == 4) {
+            p = _mm_shufflelo_epi16(p, _MM_SHUFFLE(2, 3, 0, 1));
+            p = _mm_shufflehi_epi16(p, _MM_SHUFFLE(2, 3, 0, 1));
+        }
+        p = _mm_or_si128(_mm_slli_epi16(p, 8), _mm_srli_epi16(p, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), p);
+    }
+    return i;
+}
+#elif defined(__ARM_NEON__)
+static int byteSwap_neon(uchar *dst, const uchar *src, int bytes, int pixelSize)
+{
+    int i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        const uint8x16_t p = vld1q_u8(src + i);
+        vst1q_u8(dst + i, pixelSize == 4 ? vrev32q_u8(p) : vrev16q_u8(p));
+    }
+    return i;
+}
+#endif
+
+bool qt_xcb_byteSwapKernelSupported(QXcbByteSwapKernel kernel)
+{
+    switch (kernel) {
+    case ByteSwapBest:
+    case ByteSwapScalar:
+        return true;
+#if QT_COMPILER_SUPPORTS_HERE(AVX2)
+    case ByteSwapAvx2:
+        return qCpuHasFeature(AVX2);
+#endif
+#if QT_COMPILER_SUPPORTS_HERE(SSSE3)
+    case ByteSwapSsse3:
+        return qCpuHasFeature(SSSE3);
+#endif
+#if defined(__SSE2__)
+    case ByteSwapSse2:
+        return true;
+#elif defined(__ARM_NEON__)
+    case ByteSwapNeon:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+static QXcbByteSwapKernel bestByteSwapKernel()
+{
+    for (QXcbByteSwapKernel kernel : { ByteSwapAvx2, ByteSwapSsse3, ByteSwapSse2, ByteSwapNeon }) {
+        if (qt_xcb_byteSwapKernelSupported(kernel))
+            return kernel;
+    }
+    return ByteSwapScalar;
+}
+
+// Byte swaps as many whole vectors as possible, returns the number of bytes done
+static int byteSwapVectors(uchar *dst, const uchar *src, int bytes, int pixelSize,
+                           QXcbByteSwapKernel kernel)
+{
+    static const QXcbByteSwapKernel bestKernel = bestByteSwapKernel();
+    if (kernel == ByteSwapBest)
+        kernel = bestKernel;
+
+    switch (kernel) {
+#if QT_COMPILER_SUPPORTS_HERE(AVX2)
+    case ByteSwapAvx2: {
+        const int i = byteSwap_avx2(dst, src, bytes, pixelSize);
+        // AVX2 implies SSSE3, which does the last half vector
+        return i + byteSwap_ssse3(dst + i, src + i, bytes - i, pixelSize);
+    }
+#endif
+#if QT_COMPILER_SUPPORTS_HERE(SSSE3)
+    case ByteSwapSsse3:
+        return byteSwap_ssse3(dst, src, bytes, pixelSize);
+#endif
+#if defined(__SSE2__)
+    case ByteSwapSse2:
+        return byteSwap_sse2(dst, src, bytes, pixelSize);
+#elif defined(__ARM_NEON__)
+    case ByteSwapNeon:
+        return byteSwap_neon(dst, src, bytes, pixelSize);
+#endif
+    default:
+        return 0;
+    }
+}
+
+/*!
+    Writes the \a count pixels of \a src to \a dst in the opposite byte
+    order, using \a kernel, which must be supported. \a dst and \a src may
+    be the same, but may not otherwise overlap.
+*/
+void qt_xcb_byteSwap32(quint32 *dst, const quint32 *src, int count, QXcbByteSwapKernel kernel)
+{
+    const int done = byteSwapVectors(reinterpret_cast<uchar *>(dst),
+                                     reinterpret_cast<const uchar *>(src),
+                                     count * 4, 4, kernel) / 4;
+    for (int i = done; i < count; ++i)
+        dst[i] = qbswap(src[i]);
+}
+
+void qt_xcb_byteSwap16(quint16 *dst, const quint16 *src, int count, QXcbByteSwapKernel kernel)
+{
+    const int done = byteSwapVectors(reinterpret_cast<uchar *>(dst),
+                                     reinterpret_cast<const uchar *>(src),
+                                     count * 2, 2, kernel) / 2;
+    for (int i = done; i < count; ++i)
+        dst[i] = qbswap(src[i]);
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,66 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QXCBBYTESWAP_H
+#define QXCBBYTESWAP_H
+
+#include <QtCore/qglobal.h>
+
+QT_BEGIN_NAMESPACE
+
+// The ways pixels can be byte swapped. ByteSwapBest picks the fastest one
+// this build and CPU support, the others are there to compare them.
+enum QXcbByteSwapKernel {
+    ByteSwapBest,
+    ByteSwapScalar,
+    ByteSwapSse2,
+    ByteSwapSsse3,
+    ByteSwapAvx2,
+    ByteSwapNeon
+};
+
+bool qt_xcb_byteSwapKernelSupported(QXcbByteSwapKernel kernel);
+void qt_xcb_byteSwap32(quint32 *dst, const quint32 *src, int count,
+                       QXcbByteSwapKernel kernel = ByteSwapBest);
+void qt_xcb_byteSwap16(quint16 *dst, const quint16 *src, int count,
+                       QXcbByteSwapKernel kernel = ByteSwapBest);
+
+QT_END_NAMESPACE
+
+#endif
@@ -38,8 +38,10 @@
 ****************************************************************************/
 
 #include <QtGui/private/qguiapplication_p.h>
+#include <qpa/qwindowsysteminterface_p.h>
 #include <QtCore/QDebug>
 #include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
 
 #include "qxcbconnection.h"
 #include "qxcbkeyboard.h"
@@ -50,6 +52,9 @@
 #include "qxcbintegration.h"
 #include "qxcbcursor.h"
 #include "qxcbbackingstore.h"
+#include "qxcbshmarena.h"
+#include "qxcbmemorypressure.h"
+#include "qxcbflusher.h"
 #include "qxcbeventqueue.h"
 
 #include <QAbstractEventDispatcher>
@@ -76,6 +81,8 @@ Q_LOGGING_CATEGORY(lcQpaEventReader, "qt.qpa.events.reader")
 Q_LOGGING_CATEGORY(lcQpaPeeker, "qt.qpa.peeker")
 Q_LOGGING_CATEGORY(lcQpaKeyboard, "qt.qpa.xkeyboard")
 Q_LOGGING_CATEGORY(lcQpaClipboard, "qt.qpa.clipboard")
+Q_LOGGING_CATEGORY(lcQpaFrameTiming, "qt.qpa.frametiming")
+Q_LOGGING_CATEGORY(lcQpaXcbBackingStore, "qt.qpa.xcb.backingstore")
 
 QXcbConnection::QXcbConnection(QXcbNativeInterface *nativeInterface, bool canGrabServer, xcb_visualid_t defaultVisualId, const char *displayName)
     : QXcbBasicConnection(displayName)
@@ -87,6 +94,7 @@ QXcbConnection::QXcbConnection(QXcbNativeInterface *nativeInterface, bool canGra
         return;
 
     m_eventQueue = new QXcbEventQueue(this);
+    m_memoryPressure = new QXcbMemoryPressure(this);
 
     if (hasXRandr())
         xrandrSelectEvents();
@@ -95,6 +103,9 @@ QXcbConnection::QXcbConnection(QXcbNativeInterface *nativeInterface, bool canGra
 
     if (hasXInput2()) {
         xi2SetupDevices();
+        // Every window selects XI2 events, so the server sends no core pointer
+        // events for tablets and QtGui has to synthesize the mouse events
+        QWindowSystemInterfacePrivate::TabletEvent::setPlatformSynthesizesMouse(false);
     }
 
     m_wmSupport.reset(new QXcbWMSupport(this));
@@ -122,6 +133,8 @@ QXcbConnection::~QXcbConnection()
 #ifndef QT_NO_CLIPBOARD
     delete m_clipboard;
 #endif
+    delete m_flusher;
+    delete m_shmArena;
     if (m_eventQueue)
         delete m_eventQueue;
 
@@ -133,6 +146,7 @@ QXcbConnection::~QXcbConnection()
         delete m_virtualDesktops.takeLast();
 
     delete m_keyboard;
+    delete m_memoryPressure;
 }
 
 QXcbScreen *QXcbConnection::primaryScreen() const
@@ -155,6 +169,16 @@ void QXcbConnection::removeWindowEventListener(xcb_window_t id)
     m_mapper.remove(id);
 }
 
+void QXcbConnection::addPresentEventListener(uint32_t eid, QXcbPresentEventListener *eventListener)
+{
+    m_presentMapper.insert(eid, eventListener);
+}
+
+void QXcbConnection::removePresentEventListener(uint32_t eid)
+{
+    m_presentMapper.remove(eid);
+}
+
 QXcbWindowEventListener *QXcbConnection::windowEventListenerFromId(xcb_window_t id)
 {
     return m_mapper.value(id, nullptr);
@@ -418,6 +442,13 @@ void QXcbConnection::handleXcbError(xcb_generic_error_t *error)
     if (dispatcher && dispatcher->filterNativeEvent(m_nativeInterface->nativeEventType(), error, &result))
         return;
 
+    // Selecting XI2 events on a new window isn't checked, see xi2SelectDeviceEvents()
+    if (isXIRequestError(error, XCB_INPUT_XI_SELECT_EVENTS)) {
+        qCDebug(lcQpaXInput, "failed to select events, window %x, error code %d",
+                error->resource_id, error->error_code);
+        return;
+    }
+
     printXcbError("QXcbConnection: XCB error", error);
 }
 
@@ -479,6 +510,8 @@ void QXcbConnection::handleXcbEvent(xcb_generic_event_t *event)
         HANDLE_PLATFORM_WINDOW_EVENT(xcb_unmap_notify_event_t, event, handleUnmapNotifyEvent);
     case XCB_DESTROY_NOTIFY:
         HANDLE_PLATFORM_WINDOW_EVENT(xcb_destroy_notify_event_t, event, handleDestroyNotifyEvent);
+    case XCB_VISIBILITY_NOTIFY:
+        HANDLE_PLATFORM_WINDOW_EVENT(xcb_visibility_notify_event_t, window, handleVisibilityNotifyEvent);
     case XCB_CLIENT_MESSAGE: {
         auto clientMessage = reinterpret_cast<xcb_client_message_event_t *>(event);
         if (clientMessage->format != 32)
@@ -539,10 +572,16 @@ void QXcbConnection::handleXcbEvent(xcb_generic_event_t *event)
         }
         break;
     }
+    case XCB_NO_EXPOSURE:
+        // Only asked for to learn when a backing store copy is done, see
+        // QXcbBackingStoreImage::put(); the sequence number is all that matters
+        break;
     case XCB_GE_GENERIC:
         // Here the windowEventListener is invoked from xi2HandleEvent()
         if (hasXInput2() && isXIEvent(event))
             xi2HandleEvent(reinterpret_cast<xcb_ge_event_t *>(event));
+        else if (isPresentEvent(event))
+            presentHandleEvent(reinterpret_cast<xcb_ge_event_t *>(event));
         break;
     default:
         handled = false; // event type not recognized
@@ -577,12 +616,12 @@ void QXcbConnection::handleXcbEvent(xcb_generic_event_t *event)
                     m_keyboard->updateXKBState(&xkb_event->state_notify);
                     break;
                 case XCB_XKB_MAP_NOTIFY:
-                    m_keyboard->updateKeymap();
+                    m_keyboard->scheduleKeymapUpdate();
                     break;
                 case XCB_XKB_NEW_KEYBOARD_NOTIFY: {
                     xcb_xkb_new_keyboard_notify_event_t *ev = &xkb_event->new_keyboard_notify;
                     if (ev->changed & XCB_XKB_NKN_DETAIL_KEYCODES)
-                        m_keyboard->updateKeymap();
+                        m_keyboard->scheduleKeymapUpdate();
                     break;
                 }
                 default:
@@ -678,6 +717,30 @@ xcb_window_t QXcbConnection::getQtSelectionOwner()
     return m_qtSelectionOwner;
 }
 
+QXcbShmArena *QXcbConnection::shmArena()
+{
+    if (!m_shmArena)
+        m_shmArena = new QXcbShmArena(this);
+    return m_shmArena;
+}
+
+QXcbFlusher *QXcbConnection::flusher()
+{
+    if (!m_flusher)
+        m_flusher = new QXcbFlusher(this);
+    return m_flusher;
+}
+
+/*!
+    Waits until the requests of all backing store flushes queued so far
+    have been sent, e.g. before destroying the window they draw to.
+*/
+void QXcbConnection::waitForFlushes()
+{
+    if (m_flusher)
+        m_flusher->waitForIdle();
+}
+
 xcb_window_t QXcbConnection::rootWindow()
 {
     QXcbScreen *s = primaryScreen();
@@ -821,6 +884,8 @@ void QXcbConnection::processXcbEvents(QEventLoop::ProcessEventsFlags flags)
     while (xcb_generic_event_t *event = m_eventQueue->takeFirst(flags)) {
         QScopedPointer<xcb_generic_event_t, QScopedPointerPodDeleter> eventGuard(event);
 
+        setProcessedSequence(event->full_sequence);
+
         if (!(event->response_type & ~0x80)) {
             handleXcbError(reinterpret_cast<xcb_generic_error_t *>(event));
             continue;
@@ -837,6 +902,11 @@ void QXcbConnection::processXcbEvents(QEventLoop::ProcessEventsFlags flags)
         m_eventQueue->flushBufferedEvents();
     }
 
+#if QT_CONFIG(xcb_xlib)
+    // Requests sent through xcb alone must not leave Xlib behind for good
+    keepXlibInSync(m_processedSequence);
+#endif
+
     xcb_flush(xcb_connection());
 }
 
@@ -861,6 +931,94 @@ void QXcbConnection::sync()
     // from xcb_aux_sync
     xcb_get_input_focus_cookie_t cookie = xcb_get_input_focus(xcb_connection());
     free(xcb_get_input_focus_reply(xcb_connection(), cookie, nullptr));
+    setProcessedSequence(cookie.sequence);
+}
+
+/*! \internal
+
+    Blocks until the server has processed the request with the given \a sequence
+    number. Events and errors carry the sequence number of the last request the
+    server processed before generating them, so this only falls back to a
+    round-trip when nothing generated after the request shows up in the event
+    queue in time. Callers are expected to make sure that the request generates
+    an event (e.g. a MIT-SHM completion event).
+*/
+void QXcbConnection::waitForRequest(uint sequence)
+{
+    if (isRequestProcessed(sequence))
+        return;
+
+    flush();
+
+    const int requestTimeout = 100;
+    QElapsedTimer timer;
+    timer.start();
+    while (!isRequestProcessed(sequence)) {
+        m_eventQueue->peek(QXcbEventQueue::PeekRetainMatch, [this](xcb_generic_event_t *event, int) {
+            setProcessedSequence(event->full_sequence);
+            return false;
+        });
+        if (isRequestProcessed(sequence))
+            break;
+
+        const auto elapsed = timer.elapsed();
+        if (elapsed >= requestTimeout || xcb_connection_has_error(xcb_connection())) {
+            sync();
+            break;
+        }
+        m_eventQueue->waitForNewEvents(requestTimeout - elapsed);
+    }
+}
+
+void QXcbConnection::presentHandleEvent(xcb_ge_event_t *event)
+{
+    auto *presentEvent = reinterpret_cast<xcb_present_generic_event_t *>(event);
+    QXcbPresentEventListener *listener = m_presentMapper.value(presentEvent->event, nullptr);
+    if (!listener)
+        return;
+
+    switch (presentEvent->evtype) {
+    case XCB_PRESENT_EVENT_COMPLETE_NOTIFY:
+        listener->handlePresentCompleteNotify(reinterpret_cast<xcb_present_complete_notify_event_t *>(event));
+        break;
+    case XCB_PRESENT_EVENT_IDLE_NOTIFY:
+        listener->handlePresentIdleNotify(reinterpret_cast<xcb_present_idle_notify_event_t *>(event));
+        break;
+    default:
+        break;
+    }
+}
+
+// Waits until the X server has released \a pixmap after the PresentPixmap request
+// with \a serial. The IdleNotify of an earlier request for the same pixmap often
+// arrives later than the CompleteNotify the next frame was presented on, so it
+// must not be taken for this one. The IdleNotify event is left in the queue, so
+// that the listener still sees it.
+bool QXcbConnection::waitForPresentIdle(xcb_pixmap_t pixmap, uint32_t serial)
+{
+    flush();
+
+    const int requestTimeout = 100;
+    QElapsedTimer timer;
+    timer.start();
+    for (;;) {
+        auto idleEvent = m_eventQueue->peek(QXcbEventQueue::PeekRetainMatch, [this, pixmap, serial](xcb_generic_event_t *event, int type) {
+            if (type != XCB_GE_GENERIC || !isPresentEvent(event))
+                return false;
+            auto *presentEvent = reinterpret_cast<xcb_present_generic_event_t *>(event);
+            if (presentEvent->evtype != XCB_PRESENT_EVENT_IDLE_NOTIFY)
+                return false;
+            auto *idleNotify = reinterpret_cast<xcb_present_idle_notify_event_t *>(event);
+            return idleNotify->pixmap == pixmap && idleNotify->serial == serial;
+        });
+        if (idleEvent)
+            return true;
+
+        const auto elapsed = timer.elapsed();
+        if (elapsed >= requestTimeout || xcb_connection_has_error(xcb_connection()))
+            return false;
+        m_eventQueue->waitForNewEvents(requestTimeout - elapsed);
+    }
 }
 
 bool QXcbConnection::event(QEvent *e)
@@ -42,6 +42,7 @@
 
 #include <xcb/xcb.h>
 #include <xcb/randr.h>
+#include <xcb/present.h>
 
 #include <QtCore/QTimer>
 #include <QtGui/private/qtguiglobal_p.h>
@@ -67,6 +68,8 @@ Q_DECLARE_LOGGING_CATEGORY(lcQpaPeeker)
 Q_DECLARE_LOGGING_CATEGORY(lcQpaKeyboard)
 Q_DECLARE_LOGGING_CATEGORY(lcQpaClipboard)
 Q_DECLARE_LOGGING_CATEGORY(lcQpaEventReader)
+Q_DECLARE_LOGGING_CATEGORY(lcQpaFrameTiming)
+Q_DECLARE_LOGGING_CATEGORY(lcQpaXcbBackingStore)
 
 class QXcbVirtualDesktop;
 class QXcbScreen;
@@ -75,6 +78,9 @@ class QXcbKeyboard;
 class QXcbClipboard;
 class QXcbWMSupport;
 class QXcbNativeInterface;
+class QXcbShmArena;
+class QXcbMemoryPressure;
+class QXcbFlusher;
 
 class QXcbWindowEventListener
 {
@@ -87,6 +93,7 @@ public:
     virtual void handleConfigureNotifyEvent(const xcb_configure_notify_event_t *) {}
     virtual void handleMapNotifyEvent(const xcb_map_notify_event_t *) {}
     virtual void handleUnmapNotifyEvent(const xcb_unmap_notify_event_t *) {}
+    virtual void handleVisibilityNotifyEvent(const xcb_visibility_notify_event_t *) {}
     virtual void handleDestroyNotifyEvent(const xcb_destroy_notify_event_t *) {}
     virtual void handleFocusInEvent(const xcb_focus_in_event_t *) {}
     virtual void handleFocusOutEvent(const xcb_focus_out_event_t *) {}
@@ -97,6 +104,17 @@ public:
 
 using WindowMapper = QHash<xcb_window_t, QXcbWindowEventListener *>;
 
+class QXcbPresentEventListener
+{
+public:
+    virtual ~QXcbPresentEventListener() {}
+
+    virtual void handlePresentCompleteNotify(const xcb_present_complete_notify_event_t *) {}
+    virtual void handlePresentIdleNotify(const xcb_present_idle_notify_event_t *) {}
+};
+
+using PresentEventMapper = QHash<uint32_t, QXcbPresentEventListener *>;
+
 class QXcbSyncWindowRequest : public QEvent
 {
 public:
@@ -146,6 +164,10 @@ public:
 #endif
 
     QXcbWMSupport *wmSupport() const { return m_wmSupport.data(); }
+    QXcbShmArena *shmArena();
+    QXcbMemoryPressure *memoryPressure() const { return m_memoryPressure; }
+    QXcbFlusher *flusher();
+    void waitForFlushes();
     xcb_window_t rootWindow();
     xcb_window_t clientLeader();
 
@@ -154,6 +176,11 @@ public:
 
     void sync();
 
+    bool isRequestProcessed(uint sequence) const
+    { return static_cast<int32_t>(m_processedSequence - sequence) >= 0; }
+    void waitForRequest(uint sequence);
+    bool waitForPresentIdle(xcb_pixmap_t pixmap, uint32_t serial);
+
     void handleXcbError(xcb_generic_error_t *error);
     void printXcbError(const char *message, xcb_generic_error_t *error);
     void handleXcbEvent(xcb_generic_event_t *event);
@@ -165,6 +192,9 @@ public:
     QXcbWindowEventListener *windowEventListenerFromId(xcb_window_t id);
     QXcbWindow *platformWindowFromId(xcb_window_t id);
 
+    void addPresentEventListener(uint32_t eid, QXcbPresentEventListener *eventListener);
+    void removePresentEventListener(uint32_t eid);
+
     inline xcb_timestamp_t time() const { return m_time; }
     inline void setTime(xcb_timestamp_t t) { if (timeGreaterThan(t, m_time)) m_time = t; }
 
@@ -220,6 +250,8 @@ private:
     bool compressEvent(xcb_generic_event_t *event) const;
     inline bool timeGreaterThan(xcb_timestamp_t a, xcb_timestamp_t b) const
     { return static_cast<int32_t>(a - b) > 0 || b == XCB_CURRENT_TIME; }
+    inline void setProcessedSequence(uint sequence)
+    { if (static_cast<int32_t>(sequence - m_processedSequence) > 0) m_processedSequence = sequence; }
 
     void xi2SetupDevices();
     struct ValuatorClassInfo {
@@ -233,6 +265,7 @@ private:
 
     void populateTouchDevices(void *info);
     void xi2HandleEvent(xcb_ge_event_t *event);
+    void presentHandleEvent(xcb_ge_event_t *event);
     void xi2ProcessTouch(void *xiDevEvent, QXcbWindow *platformWindow);
 
     static bool xi2GetValuatorValueIfSet(const void *event, int valuatorNum, double *value);
@@ -247,6 +280,7 @@ private:
     QList<QXcbScreen *> m_screens;
 
     xcb_timestamp_t m_time = XCB_CURRENT_TIME;
+    uint m_processedSequence = 0;
     xcb_timestamp_t m_netWmUserTime = XCB_CURRENT_TIME;
 
     QXcbKeyboard *m_keyboard = nullptr;
@@ -257,8 +291,12 @@ private:
     QXcbNativeInterface *m_nativeInterface = nullptr;
 
     QXcbEventQueue *m_eventQueue = nullptr;
+    QXcbShmArena *m_shmArena = nullptr;
+    QXcbMemoryPressure *m_memoryPressure = nullptr;
+    QXcbFlusher *m_flusher = nullptr;
 
     WindowMapper m_mapper;
+    PresentEventMapper m_presentMapper;
 
     QXcbWindow *m_focusWindow = nullptr;
     QXcbWindow *m_mouseGrabber = nullptr;
@@ -37,8 +37,9 @@
 **
 ****************************************************************************/
 #include "qxcbconnection_basic.h"
-#include "qxcbbackingstore.h" // for createSystemVShmSegment()
+#include "qxcbbackingstore.h" // for createSystemVShmSegment() and createMemfdShmSegment()
 
+#include <xcb/present.h>
 #include <xcb/randr.h>
 #include <xcb/shm.h>
 #include <xcb/sync.h>
@@ -50,6 +51,8 @@
 #include <xcb/xkb.h>
 #undef explicit
 
+#include <sys/socket.h>
+
 #if QT_CONFIG(xcb_xlib)
 #define register        /* C++17 deprecated register */
 #include <X11/Xlib.h>
@@ -134,7 +137,7 @@ QXcbBasicConnection::QXcbBasicConnection(const char *displayName)
 
     xcb_extension_t *extensions[] = {
         &xcb_shm_id, &xcb_xfixes_id, &xcb_randr_id, &xcb_shape_id, &xcb_sync_id,
-        &xcb_render_id, &xcb_xkb_id, &xcb_input_id, nullptr
+        &xcb_render_id, &xcb_xkb_id, &xcb_input_id, &xcb_present_id, nullptr
     };
 
     for (xcb_extension_t **ext_it = extensions; *ext_it; ++ext_it)
@@ -152,6 +155,7 @@ QXcbBasicConnection::QXcbBasicConnection(const char *displayName)
     initializeXInput2();
     initializeXShape();
     initializeXKB();
+    initializePresent();
 }
 
 QXcbBasicConnection::~QXcbBasicConnection()
@@ -165,6 +169,29 @@ QXcbBasicConnection::~QXcbBasicConnection()
     }
 }
 
+#if QT_CONFIG(xcb_xlib)
+/*!
+    Xlib tracks the sequence numbers of xcb requests only when it sees their
+    replies or errors, and wraps its 16-bit counter wrongly when more than
+    65536 requests went by without it (QTBUG-29106).
+
+    Syncs Xlib if more than 32k requests went by since it was last synced,
+    up to the request with \a sequence. Window creation calls this with the
+    request it just sent, and event processing with the last request the
+    server is known to have processed, so Xlib lags by at most about half of
+    what it can cope with, leaving the rest for requests still in flight.
+    That replaces an XSync per created window.
+*/
+void QXcbBasicConnection::keepXlibInSync(uint sequence)
+{
+    if (sequence - m_xlibSyncedSequence < 0x8000)
+        return;
+
+    XSync(static_cast<Display *>(m_xlibDisplay), false);
+    m_xlibSyncedSequence = sequence;
+}
+#endif
+
 size_t QXcbBasicConnection::maxRequestDataBytes(size_t requestSize) const
 {
     if (hasBigRequest())
@@ -226,6 +253,20 @@ bool QXcbBasicConnection::isXIType(xcb_generic_event_t *event, uint16_t type) co
     return e->event_type == type;
 }
 
+bool QXcbBasicConnection::isXIRequestError(xcb_generic_error_t *error, uint16_t minorCode) const
+{
+    return m_xi2Enabled && error->major_code == m_xiOpCode && error->minor_code == minorCode;
+}
+
+bool QXcbBasicConnection::isPresentEvent(xcb_generic_event_t *event) const
+{
+    if (!m_hasPresent)
+        return false;
+
+    auto *e = reinterpret_cast<qt_xcb_ge_event_t *>(event);
+    return e->extension == m_presentOpCode;
+}
+
 bool QXcbBasicConnection::isXFixesType(uint responseType, int eventType) const
 {
     return m_hasXFixes && responseType == m_xfixesFirstEvent + eventType;
@@ -250,6 +291,28 @@ void QXcbBasicConnection::initializeXSync()
     m_hasXSync = true;
 }
 
+void QXcbBasicConnection::initializePresent()
+{
+    const xcb_query_extension_reply_t *reply = xcb_get_extension_data(m_xcbConnection, &xcb_present_id);
+    if (!reply || !reply->present) {
+        qCDebug(lcQpaXcb, "Present extension is not present on the X server");
+        return;
+    }
+
+    auto presentQuery = Q_XCB_REPLY(xcb_present_query_version, m_xcbConnection,
+                                    XCB_PRESENT_MAJOR_VERSION,
+                                    XCB_PRESENT_MINOR_VERSION);
+    if (!presentQuery) {
+        qCWarning(lcQpaXcb, "failed to request Present version");
+        return;
+    }
+
+    m_hasPresent = true;
+    m_presentOpCode = reply->major_opcode;
+    qCDebug(lcQpaXcb) << "Has Present     :" << m_hasPresent
+                      << presentQuery->major_version << presentQuery->minor_version;
+}
+
 void QXcbBasicConnection::initializeShm()
 {
     const xcb_query_extension_reply_t *reply = xcb_get_extension_data(m_xcbConnection, &xcb_shm_id);
@@ -265,8 +328,24 @@ void QXcbBasicConnection::initializeShm()
     }
 
     m_hasShm = true;
+    m_hasShmFd = (shmQuery->major_version == 1 && shmQuery->minor_version >= 2) ||
+                 shmQuery->major_version > 1;
+    if (m_hasShmFd) {
+        // File descriptors can only be passed over a local socket; trying to
+        // do so on a TCP connection would break the connection.
+        sockaddr_storage address;
+        socklen_t length = sizeof(address);
+        const int fd = xcb_get_file_descriptor(m_xcbConnection);
+        if (getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length) != 0
+                || address.ss_family != AF_UNIX)
+            m_hasShmFd = false;
+    }
+    m_hasShmPixmaps = shmQuery->shared_pixmaps && shmQuery->pixmap_format == XCB_IMAGE_FORMAT_Z_PIXMAP
+            && !qEnvironmentVariableIsSet("QT_XCB_NO_SHM_PIXMAPS");
 
     qCDebug(lcQpaXcb) << "Has MIT-SHM     :" << m_hasShm;
+    qCDebug(lcQpaXcb) << "Has MIT-SHM FD  :" << m_hasShmFd;
+    qCDebug(lcQpaXcb) << "Has SHM pixmaps :" << m_hasShmPixmaps;
 
     // Temporary disable warnings (unless running in debug mode).
     auto logging = const_cast<QLoggingCategory*>(&lcQpaXcb());
@@ -274,9 +353,16 @@ void QXcbBasicConnection::initializeShm()
     if (!logging->isEnabled(QtMsgType::QtDebugMsg))
         logging->setEnabled(QtMsgType::QtWarningMsg, false);
     if (!QXcbBackingStore::createSystemVShmSegment(m_xcbConnection)) {
-        qCDebug(lcQpaXcb, "failed to create System V shared memory segment (remote "
-                          "X11 connection?), disabling SHM");
-        m_hasShm = false;
+        if (m_hasShmFd && QXcbBackingStore::createMemfdShmSegment(m_xcbConnection)) {
+            qCDebug(lcQpaXcb, "failed to create System V shared memory segment, "
+                              "using memfd segments only");
+        } else {
+            qCDebug(lcQpaXcb, "failed to create System V shared memory segment (remote "
+                              "X11 connection?), disabling SHM");
+            m_hasShm = false;
+            m_hasShmFd = false;
+            m_hasShmPixmaps = false;
+        }
     }
     if (wasEnabled)
         logging->setEnabled(QtMsgType::QtWarningMsg, true);
@@ -65,6 +65,7 @@ public:
 
 #if QT_CONFIG(xcb_xlib)
     void *xlib_display() const { return m_xlibDisplay; }
+    void keepXlibInSync(uint sequence);
 #endif
     const char *displayName() const { return m_displayName.constData(); }
     int primaryScreenNumber() const { return m_primaryScreenNumber; }
@@ -94,12 +95,17 @@ public:
     }
     bool hasXInput2() const { return m_xi2Enabled; }
     bool hasShm() const { return m_hasShm; }
+    bool hasShmFd() const { return m_hasShmFd; }
+    bool hasShmPixmaps() const { return m_hasShmPixmaps; }
     bool hasXSync() const { return m_hasXSync; }
+    bool hasPresent() const { return m_hasPresent; }
     bool hasXinerama() const { return m_hasXinerama; }
     bool hasBigRequest() const;
 
     bool isXIEvent(xcb_generic_event_t *event) const;
     bool isXIType(xcb_generic_event_t *event, uint16_t type) const;
+    bool isXIRequestError(xcb_generic_error_t *error, uint16_t minorCode) const;
+    bool isPresentEvent(xcb_generic_event_t *event) const;
 
     bool isXFixesType(uint responseType, int eventType) const;
     bool isXRandrType(uint responseType, int eventType) const;
@@ -115,10 +121,12 @@ protected:
     void initializeXKB();
     void initializeXSync();
     void initializeXInput2();
+    void initializePresent();
 
 private:
 #if QT_CONFIG(xcb_xlib)
     void *m_xlibDisplay = nullptr;
+    uint m_xlibSyncedSequence = 0;
 #endif
     QByteArray m_displayName;
     xcb_connection_t *m_xcbConnection = nullptr;
@@ -134,7 +142,11 @@ private:
     bool m_hasXkb = false;
     bool m_hasXRender = false;
     bool m_hasShm = false;
+    bool m_hasShmFd = false;
+    bool m_hasShmPixmaps = false;
     bool m_hasXSync = false;
+    bool m_hasPresent = false;
+    int m_presentOpCode = -1;
 
     QPair<int, int> m_xrenderVersion;
 
@@ -73,15 +73,9 @@ void QXcbConnection::xi2SelectDeviceEvents(xcb_window_t window)
     mask.header.deviceid = XCB_INPUT_DEVICE_ALL_MASTER;
     mask.header.mask_len = 1;
     mask.mask = bitMask;
-    xcb_void_cookie_t cookie =
-            xcb_input_xi_select_events_checked(xcb_connection(), window, 1, &mask.header);
-    xcb_generic_error_t *error = xcb_request_check(xcb_connection(), cookie);
-    if (error) {
-        qCDebug(lcQpaXInput, "failed to select events, window %x, error code %d", window, error->error_code);
-        free(error);
-    } else {
-        QWindowSystemInterfacePrivate::TabletEvent::setPlatformSynthesizesMouse(false);
-    }
+    // Not checked: this runs for every new window and a round-trip here would
+    // stall window creation. handleXcbError() logs the errors instead.
+    xcb_input_xi_select_events(xcb_connection(), window, 1, &mask.header);
 }
 
 static inline qreal fixed3232ToReal(xcb_input_fp3232_t val)
@@ -306,6 +306,7 @@ QXcbCursor::QXcbCursor(QXcbConnection *conn, QXcbScreen *screen)
     // see NUM_BITMAPS in libXcursor/src/xcursorint.h
     m_bitmapCache.setMaxCost(8);
 #endif
+    connection()->memoryPressure()->addTrimmer("cursors", this);
 
     if (cursorCount++)
         return;
@@ -343,6 +344,8 @@ QXcbCursor::~QXcbCursor()
 {
     xcb_connection_t *conn = xcb_connection();
 
+    connection()->memoryPressure()->removeTrimmer(this);
+
     if (m_gtkCursorThemeInitialized) {
         m_screen->xSettings()->removeCallbackForHandle(this);
     }
@@ -356,7 +359,41 @@ QXcbCursor::~QXcbCursor()
 #endif
 }
 
+/*!
+    Frees the cached cursors. Windows keep the cursors they use alive on the
+    server, and the ones needed again are created anew. The size of theme and
+    font cursors is not known, so only that of bitmap cursors is accounted.
+*/
+qint64 QXcbCursor::trimMemory()
+{
+    qint64 releasedBytes = 0;
 #ifndef QT_NO_CURSOR
+    const auto keys = m_bitmapCache.keys();
+    for (const QXcbCursorCacheKey &key : keys)
+        releasedBytes += m_bitmapCache.object(key)->bytes;
+    m_bitmapCache.clear();
+
+    qCDebug(lcQpaXcb) << "memory pressure: freeing" << keys.size() << "bitmap and"
+                      << m_cursorHash.size() << "shape cursors";
+    for (xcb_cursor_t cursor : qAsConst(m_cursorHash))
+        xcb_free_cursor(xcb_connection(), cursor);
+    m_cursorHash.clear();
+#endif
+    return releasedBytes;
+}
+
+#ifndef QT_NO_CURSOR
+static qint64 cursorImageBytes(const QCursor &cursor)
+{
+    const QPixmap pixmap = cursor.pixmap();
+    if (pixmap.depth() > 1)
+        return qint64(pixmap.width()) * pixmap.height() * 4;
+
+    // The bitmap and the mask
+    const QSize size = cursor.bitmap(Qt::ReturnByValue).size();
+    return 2 * qint64((size.width() + 7) / 8) * size.height();
+}
+
 void QXcbCursor::changeCursor(QCursor *cursor, QWindow *window)
 {
     if (!window || !window->handle())
@@ -373,7 +410,7 @@ void QXcbCursor::changeCursor(QCursor *cursor, QWindow *window)
                 c = bitmap->cursor;
             } else {
                 c = createBitmapCursor(cursor);
-                m_bitmapCache.insert(key, new CachedCursor(xcb_connection(), c));
+                m_bitmapCache.insert(key, new CachedCursor(xcb_connection(), c, cursorImageBytes(*cursor)));
             }
         } else {
             auto it = m_cursorHash.find(key);
@@ -42,6 +42,7 @@
 
 #include <qpa/qplatformcursor.h>
 #include "qxcbscreen.h"
+#include "qxcbmemorypressure.h"
 
 #include <QtCore/QCache>
 
@@ -72,7 +73,7 @@ inline uint qHash(const QXcbCursorCacheKey &k, uint seed) noexcept
 
 #endif // !QT_NO_CURSOR
 
-class QXcbCursor : public QXcbObject, public QPlatformCursor
+class QXcbCursor : public QXcbObject, public QPlatformCursor, public QXcbMemoryTrimmer
 {
 public:
     QXcbCursor(QXcbConnection *conn, QXcbScreen *screen);
@@ -83,6 +84,8 @@ public:
     QPoint pos() const override;
     void setPos(const QPoint &pos) override;
 
+    qint64 trimMemory() override;
+
     static void queryPointer(QXcbConnection *c, QXcbVirtualDesktop **virtualDesktop, QPoint *pos, int *keybMask = nullptr);
 
 #ifndef QT_NO_CURSOR
@@ -97,11 +100,12 @@ private:
 
     struct CachedCursor
     {
-        explicit CachedCursor(xcb_connection_t *conn, xcb_cursor_t c)
-            : cursor(c), connection(conn) {}
+        explicit CachedCursor(xcb_connection_t *conn, xcb_cursor_t c, qint64 size)
+            : cursor(c), connection(conn), bytes(size) {}
         ~CachedCursor() { xcb_free_cursor(connection, cursor); }
         xcb_cursor_t cursor;
         xcb_connection_t *connection;
+        qint64 bytes; // of the image, as far as we know
     };
     typedef QCache<QXcbCursorCacheKey, CachedCursor> BitmapCursorCache;
 
@@ -0,0 +1,258 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qxcbdamagetiles.h"
+
+#include <algorithm>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+    \class QXcbDamageTiles
+    \internal
+
+    Tracks damage of a backing store image on a grid of TileSize x TileSize
+    tiles. Marking a rectangle costs one store per tile it touches, instead
+    of the region arithmetic which gets expensive with fragmented damage.
+
+    Tracking is conservative: a tile is dirty as soon as any of its pixels
+    is, and only becomes clean again when all of its pixels are.
+*/
+
+static inline int tilesFor(int pixels)
+{
+    return (pixels + QXcbDamageTiles::TileSize - 1) / QXcbDamageTiles::TileSize;
+}
+
+void QXcbDamageTiles::resize(const QSize &size)
+{
+    if (size == m_size)
+        return;
+
+    const int columns = tilesFor(qMax(size.width(), 0));
+    const int rows = tilesFor(qMax(size.height(), 0));
+
+    // The grid starts at the origin, so tiles shared by the old and
+    // the new size keep their state.
+    QVector<bool> tiles(columns * rows, false);
+    int dirtyTiles = 0;
+    for (int y = 0; y < qMin(rows, m_rows); ++y) {
+        for (int x = 0; x < qMin(columns, m_columns); ++x) {
+            if (m_tiles.at(y * m_columns + x)) {
+                tiles[y * columns + x] = true;
+                ++dirtyTiles;
+            }
+        }
+    }
+
+    m_size = size;
+    m_columns = columns;
+    m_rows = rows;
+    m_tiles = tiles;
+    m_dirtyTiles = dirtyTiles;
+}
+
+void QXcbDamageTiles::clear()
+{
+    if (m_dirtyTiles == 0)
+        return;
+    m_tiles.fill(false);
+    m_dirtyTiles = 0;
+}
+
+void QXcbDamageTiles::add(const QRect &rect)
+{
+    const QRect r = rect & QRect(QPoint(), m_size);
+    if (r.isEmpty())
+        return;
+
+    const int right = r.right() / TileSize;
+    const int bottom = r.bottom() / TileSize;
+    for (int y = r.top() / TileSize; y <= bottom; ++y) {
+        bool *tile = m_tiles.data() + y * m_columns;
+        for (int x = r.left() / TileSize; x <= right; ++x) {
+            if (!tile[x]) {
+                tile[x] = true;
+                ++m_dirtyTiles;
+            }
+        }
+    }
+}
+
+void QXcbDamageTiles::add(const QRegion &region)
+{
+    for (const QRect &rect : region)
+        add(rect);
+}
+
+void QXcbDamageTiles::subtract(const QRect &rect)
+{
+    const QRect r = rect & QRect(QPoint(), m_size);
+    if (r.isEmpty() || m_dirtyTiles == 0)
+        return;
+
+    // Only tiles which are covered completely, where the tiles on the
+    // right and bottom edges end with the image.
+    const int left = tilesFor(r.left());
+    const int top = tilesFor(r.top());
+    const int right = r.right() == m_size.width() - 1 ? m_columns - 1
+                                                      : (r.right() + 1) / TileSize - 1;
+    const int bottom = r.bottom() == m_size.height() - 1 ? m_rows - 1
+                                                         : (r.bottom() + 1) / TileSize - 1;
+    for (int y = top; y <= bottom; ++y) {
+        bool *tile = m_tiles.data() + y * m_columns;
+        for (int x = left; x <= right; ++x) {
+            if (tile[x]) {
+                tile[x] = false;
+                --m_dirtyTiles;
+            }
+        }
+    }
+}
+
+void QXcbDamageTiles::subtract(const QRegion &region)
+{
+    for (const QRect &rect : region)
+        subtract(rect);
+}
+
+/*!
+    Returns the dirty part of \a clip as a few rectangles which are cheap
+    to upload. Runs of dirty tiles are combined into rows, rows of the
+    same extent into blocks, and the blocks are then merged further as
+    long as that is cheaper than uploading them separately; see merged().
+*/
+QVector<QRect> QXcbDamageTiles::spans(const QRect &clip, int bytesPerPixel, int requestCost) const
+{
+    QVector<QRect> spans;
+
+    const QRect bounds = clip & QRect(QPoint(), m_size);
+    if (bounds.isEmpty() || m_dirtyTiles == 0)
+        return spans;
+
+    const int left = bounds.left() / TileSize;
+    const int right = bounds.right() / TileSize;
+    const int top = bounds.top() / TileSize;
+    const int bottom = bounds.bottom() / TileSize;
+
+    // Indices of the spans ending in the previous row of tiles, which
+    // runs of the same extent in the current row extend
+    QVector<int> previousRow;
+    QVector<int> currentRow;
+
+    for (int y = top; y <= bottom; ++y) {
+        const bool *tile = m_tiles.constData() + y * m_columns;
+        currentRow.clear();
+
+        for (int x = left; x <= right; ++x) {
+            if (!tile[x])
+                continue;
+            const int runStart = x;
+            while (x < right && tile[x + 1])
+                ++x;
+
+            const QRect run = QRect(runStart * TileSize, y * TileSize,
+                                    (x - runStart + 1) * TileSize, TileSize) & bounds;
+            auto above = std::find_if(previousRow.cbegin(), previousRow.cend(), [&](int i) {
+                const QRect &span = spans.at(i);
+                return span.left() == run.left() && span.right() == run.right();
+            });
+            if (above != previousRow.cend()) {
+                spans[*above].setBottom(run.bottom());
+                currentRow.append(*above);
+            } else {
+                currentRow.append(spans.size());
+                spans.append(run);
+            }
+        }
+
+        previousRow.swap(currentRow);
+    }
+
+    return merged(spans, bytesPerPixel, requestCost);
+}
+
+static inline qint64 uploadCost(const QRect &rect, int bytesPerPixel, int requestCost)
+{
+    return requestCost + qint64(rect.width()) * rect.height() * bytesPerPixel;
+}
+
+/*!
+    Merges \a rects into their bounding rectangles as long as that does not
+    cost more than uploading them separately, where every upload request
+    costs \a requestCost bytes on top of the bytes it transfers. The result
+    covers at least the area of \a rects and may cover more.
+*/
+QVector<QRect> QXcbDamageTiles::merged(QVector<QRect> rects, int bytesPerPixel, int requestCost)
+{
+    // Rects close to each other in the list are usually close to each other
+    // on screen too, only look back that far to keep this linear.
+    const int lookBack = 8;
+
+    bool changed = rects.size() > 1;
+    while (changed) {
+        changed = false;
+        QVector<QRect> result;
+        result.reserve(rects.size());
+
+        for (const QRect &rect : qAsConst(rects)) {
+            bool mergedRect = false;
+            for (int i = result.size() - 1; i >= qMax(0, result.size() - lookBack); --i) {
+                const QRect united = result.at(i).united(rect);
+                if (uploadCost(united, bytesPerPixel, requestCost)
+                        <= uploadCost(result.at(i), bytesPerPixel, requestCost)
+                           + uploadCost(rect, bytesPerPixel, requestCost)) {
+                    result[i] = united;
+                    mergedRect = true;
+                    break;
+                }
+            }
+            if (mergedRect)
+                changed = true;
+            else
+                result.append(rect);
+        }
+
+        rects.swap(result);
+    }
+
+    return rects;
+}
+
+QT_END_NAMESPACE
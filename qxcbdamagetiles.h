@@ -0,0 +1,79 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QXCBDAMAGETILES_H
+#define QXCBDAMAGETILES_H
+
+#include <QtCore/QRect>
+#include <QtCore/QVector>
+#include <QtGui/QRegion>
+
+QT_BEGIN_NAMESPACE
+
+class QXcbDamageTiles
+{
+public:
+    enum { TileSize = 64 };
+
+    QSize size() const { return m_size; }
+    void resize(const QSize &size);
+
+    bool isEmpty() const { return m_dirtyTiles == 0; }
+    void clear();
+
+    void add(const QRect &rect);
+    void add(const QRegion &region);
+    void subtract(const QRect &rect);
+    void subtract(const QRegion &region);
+
+    QVector<QRect> spans(const QRect &clip, int bytesPerPixel, int requestCost) const;
+
+    static QVector<QRect> merged(QVector<QRect> rects, int bytesPerPixel, int requestCost);
+
+private:
+    QSize m_size;
+    int m_columns = 0;
+    int m_rows = 0;
+    int m_dirtyTiles = 0;
+    QVector<bool> m_tiles;
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,154 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qxcbflusher.h"
+#include "qxcbconnection.h"
+
+#include <QtCore/QMutexLocker>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+    \class QXcbFlusher
+    \internal
+
+    Builds and sends the requests of backing store flushes on a thread of
+    its own, so that the GUI thread can go back to processing events while
+    the content is uploaded. Jobs run in the order they were queued. Each
+    job has a completion, e.g. answering a sync request of the window
+    manager, which runs on the GUI thread once the requests of the job have
+    been sent, so that it is ordered after them. Completions run from the
+    event loop, or right away when the GUI thread waits for a job.
+*/
+
+QXcbFlusher::QXcbFlusher(QXcbConnection *connection)
+    : m_connection(connection)
+{
+    setObjectName(QStringLiteral("QXcbFlusher"));
+    start();
+}
+
+QXcbFlusher::~QXcbFlusher()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_quit = true;
+        m_jobQueued.wakeOne();
+    }
+    wait();
+    processCompletions();
+}
+
+/*!
+    Queues \a work to run on the flusher thread, and \a completion to run
+    on the GUI thread once it is done. Returns the ticket of the job.
+*/
+quint64 QXcbFlusher::enqueue(const Task &work, const Task &completion)
+{
+    QMutexLocker locker(&m_mutex);
+    m_jobs.append({ ++m_lastTicket, work, completion });
+    m_jobQueued.wakeOne();
+    return m_lastTicket;
+}
+
+bool QXcbFlusher::isDone(quint64 ticket)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_doneTicket >= ticket;
+}
+
+/*!
+    Blocks until the job with \a ticket is done, and runs the completions
+    of the jobs done so far.
+*/
+void QXcbFlusher::waitFor(quint64 ticket)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        while (m_doneTicket < ticket)
+            m_jobDone.wait(&m_mutex);
+    }
+    processCompletions();
+}
+
+void QXcbFlusher::run()
+{
+    forever {
+        Job job;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_jobs.isEmpty() && !m_quit)
+                m_jobQueued.wait(&m_mutex);
+            if (m_jobs.isEmpty())
+                return;
+            job = m_jobs.takeFirst();
+        }
+
+        job.work();
+        xcb_flush(m_connection->xcb_connection());
+
+        bool post = false;
+        {
+            QMutexLocker locker(&m_mutex);
+            m_doneTicket = job.ticket;
+            if (job.completion) {
+                m_completions.append(job.completion);
+                post = !m_completionsPosted;
+                m_completionsPosted = true;
+            }
+            m_jobDone.wakeAll();
+        }
+        if (post)
+            QMetaObject::invokeMethod(this, [this]() { processCompletions(); }, Qt::QueuedConnection);
+    }
+}
+
+void QXcbFlusher::processCompletions()
+{
+    QVector<Task> completions;
+    {
+        QMutexLocker locker(&m_mutex);
+        completions.swap(m_completions);
+        m_completionsPosted = false;
+    }
+    for (const Task &completion : qAsConst(completions))
+        completion();
+}
+
+QT_END_NAMESPACE
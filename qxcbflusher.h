@@ -0,0 +1,93 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QXCBFLUSHER_H
+#define QXCBFLUSHER_H
+
+#include <QtCore/QThread>
+#include <QtCore/QMutex>
+#include <QtCore/QVector>
+#include <QtCore/QWaitCondition>
+
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+
+class QXcbConnection;
+
+class QXcbFlusher : public QThread
+{
+public:
+    QXcbFlusher(QXcbConnection *connection);
+    ~QXcbFlusher();
+
+    using Task = std::function<void()>;
+
+    quint64 enqueue(const Task &work, const Task &completion);
+    bool isDone(quint64 ticket);
+    void waitFor(quint64 ticket);
+    void waitForIdle() { waitFor(m_lastTicket); }
+
+    void run() override;
+
+private:
+    void processCompletions();
+
+    struct Job {
+        quint64 ticket;
+        Task work;
+        Task completion;
+    };
+
+    QXcbConnection *m_connection;
+
+    QMutex m_mutex;
+    QWaitCondition m_jobQueued;
+    QWaitCondition m_jobDone;
+    QVector<Job> m_jobs;
+    QVector<Task> m_completions;
+    quint64 m_lastTicket = 0; // only used by the GUI thread
+    quint64 m_doneTicket = 0;
+    bool m_completionsPosted = false;
+    bool m_quit = false;
+};
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,181 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qxcbframeclock.h"
+#include "qxcbwindow.h"
+
+#include <QtCore/QDeadlineTimer>
+#include <QtGui/private/qwindow_p.h>
+
+#include <algorithm>
+#include <limits>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+    \class QXcbFrameClock
+    \internal
+
+    Delivers the update requests of all windows on a screen together, at
+    most once per refresh interval of the screen. When it is known when a
+    frame was shown, e.g. from a Present completion, the ticks are aligned
+    to the vertical blank. Windows which are not exposed get at most one
+    update per second. The clock only runs while a window is waiting for
+    an update.
+*/
+
+// Windows nobody can see only get enough updates to keep them going
+static const qint64 HiddenIntervalNs = 1000000000;
+
+static inline qint64 currentTimeNs()
+{
+    // CLOCK_MONOTONIC, which is also what Present and the frame timings use
+    return QDeadlineTimer::current(Qt::PreciseTimer).deadlineNSecs();
+}
+
+QXcbFrameClock::QXcbFrameClock()
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    m_timer.callOnTimeout([this]() { tick(); });
+}
+
+QXcbFrameClock::~QXcbFrameClock()
+{
+    // Don't leave the windows waiting, fall back to the default timer
+    for (QXcbWindow *window : qAsConst(m_windows))
+        window->QPlatformWindow::requestUpdate();
+}
+
+void QXcbFrameClock::requestUpdate(QXcbWindow *window)
+{
+    if (!m_windows.contains(window))
+        m_windows.append(window);
+    scheduleTick();
+}
+
+void QXcbFrameClock::cancelUpdate(QXcbWindow *window)
+{
+    m_windows.removeAll(window);
+    m_hiddenDeliveryNs.remove(window);
+    std::replace(m_delivering.begin(), m_delivering.end(), window, static_cast<QXcbWindow *>(nullptr));
+    if (m_windows.isEmpty())
+        m_timer.stop();
+}
+
+void QXcbFrameClock::setRefreshRate(qreal refreshRate)
+{
+    if (refreshRate < 1 || refreshRate > 1000)
+        refreshRate = 60;
+    m_intervalNs = qint64(1000000000 / refreshRate);
+}
+
+/*!
+    Aligns the ticks to a frame that was shown at \a timestampNs.
+*/
+void QXcbFrameClock::frameShown(qint64 timestampNs)
+{
+    // Ignore timestamps from a clock other than ours
+    if (timestampNs > 0 && timestampNs <= currentTimeNs())
+        m_phaseNs = timestampNs;
+}
+
+/*!
+    Starts the timer for the earliest update that is due, e.g. again after
+    a window waiting for an update became exposed.
+*/
+void QXcbFrameClock::scheduleTick()
+{
+    if (m_windows.isEmpty()) {
+        m_timer.stop();
+        return;
+    }
+
+    const qint64 now = currentTimeNs();
+    qint64 nextFrame = now + m_intervalNs - (now - m_phaseNs) % m_intervalNs;
+    if (nextFrame - m_lastTickNs < m_intervalNs / 2)
+        nextFrame += m_intervalNs;
+
+    qint64 next = std::numeric_limits<qint64>::max();
+    for (QXcbWindow *window : qAsConst(m_windows))
+        next = std::min(next, dueTime(window, nextFrame));
+
+    const int delay = int((next - now + 999999) / 1000000);
+    if (!m_timer.isActive() || m_timer.remainingTime() > delay)
+        m_timer.start(delay);
+}
+
+qint64 QXcbFrameClock::dueTime(QXcbWindow *window, qint64 nextFrameNs) const
+{
+    if (window->isExposed())
+        return nextFrameNs;
+    return std::max(nextFrameNs, m_hiddenDeliveryNs.value(window) + HiddenIntervalNs);
+}
+
+void QXcbFrameClock::tick()
+{
+    const qint64 now = currentTimeNs();
+    m_lastTickNs = now;
+
+    // Windows may request the next update, or be destroyed, while
+    // the current ones are delivered
+    m_delivering.swap(m_windows);
+    for (int i = 0; i < m_delivering.size(); ++i) {
+        QXcbWindow *window = m_delivering.at(i);
+        if (!window)
+            continue;
+        // The compositor hasn't drawn the last frame yet, or the window
+        // isn't due yet, try again next time
+        if (window->isWaitingForFrameDrawn() || dueTime(window, now) > now + m_intervalNs / 2) {
+            if (!m_windows.contains(window))
+                m_windows.append(window);
+            continue;
+        }
+        if (window->isExposed())
+            m_hiddenDeliveryNs.remove(window);
+        else
+            m_hiddenDeliveryNs.insert(window, now);
+        qt_window_private(window->window())->deliverUpdateRequest();
+    }
+    m_delivering.clear();
+
+    scheduleTick();
+}
+
+QT_END_NAMESPACE
@@ -42,6 +42,7 @@
 #include <QtGui/QColor>
 #include <QtGui/private/qimage_p.h>
 #include <QtGui/private/qdrawhelper_p.h>
+#include <QtCore/private/qsimd_p.h>
 
 #include <xcb/render.h>
 #include <xcb/xcb_renderutil.h>
@@ -277,4 +278,173 @@ xcb_cursor_t qt_xcb_createCursorXRender(QXcbScreen *screen, const QImage &image,
     return cursor;
 }
 
+/*!
+    Returns whether the red and blue channels of \a format can be swapped
+    with qt_xcb_swapRedBlue().
+
+    These are the formats qt_xcb_imageFormatForVisual() picks for visuals that
+    need a swap: RGB16 and RGB555 for 16-bit BGR visuals, and the ARGB32
+    formats for 32-bit ones whose masks only match once swapped, which with
+    the 8888 formats available happens on big endian hosts.
+*/
+bool qt_xcb_canSwapRedBlue(QImage::Format format)
+{
+    switch (format) {
+    case QImage::Format_RGB16:
+    case QImage::Format_RGB555:
+    case QImage::Format_RGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static inline quint32 swapRedBlue32(quint32 p)
+{
+    return (p & 0xff00ff00) | ((p >> 16) & 0xff) | ((p & 0xff) << 16);
+}
+
+#if QT_COMPILER_SUPPORTS_HERE(AVX2)
+QT_FUNCTION_TARGET(AVX2)
+static int swapRedBlue32_avx2(quint32 *dst, const quint32 *src, int count)
+{
+    const __m256i greenAlpha = _mm256_set1_epi32(int(0xff00ff00));
+    const __m256i lowByte = _mm256_set1_epi32(0xff);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+        const __m256i red = _mm256_and_si256(_mm256_srli_epi32(p, 16), lowByte);
+        const __m256i blue = _mm256_slli_epi32(_mm256_and_si256(p, lowByte), 16);
+        const __m256i result = _mm256_or_si256(_mm256_and_si256(p, greenAlpha),
+                                               _mm256_or_si256(red, blue));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), result);
+    }
+    return i;
+}
+#endif
+
+#if defined(__SSE2__)
+static int swapRedBlue32_sse2(quint32 *dst, const quint32 *src, int count)
+{
+    const __m128i greenAlpha = _mm_set1_epi32(int(0xff00ff00));
+    const __m128i lowByte = _mm_set1_epi32(0xff);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        const __m128i red = _mm_and_si128(_mm_srli_epi32(p, 16), lowByte);
+        const __m128i blue = _mm_slli_epi32(_mm_and_si128(p, lowByte), 16);
+        const __m128i result = _mm_or_si128(_mm_and_si128(p, greenAlpha),
+                                            _mm_or_si128(red, blue));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), result);
+    }
+    return i;
+}
+#elif defined(__ARM_NEON__)
+static int swapRedBlue32_neon(quint32 *dst, const quint32 *src, int count)
+{
+    const uint32x4_t greenAlpha = vdupq_n_u32(0xff00ff00);
+    const uint32x4_t lowByte = vdupq_n_u32(0xff);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const uint32x4_t p = vld1q_u32(src + i);
+        const uint32x4_t red = vandq_u32(vshrq_n_u32(p, 16), lowByte);
+        const uint32x4_t blue = vshlq_n_u32(vandq_u32(p, lowByte), 16);
+        vst1q_u32(dst + i, vorrq_u32(vandq_u32(p, greenAlpha), vorrq_u32(red, blue)));
+    }
+    return i;
+}
+#endif
+
+// Swaps the 5-bit red and blue fields of RGB16 (blueShift 11) and RGB555
+// (blueShift 10) pixels; green and the unused top bit of RGB555 stay put.
+static inline quint16 swapRedBlue16(quint16 p, int blueShift)
+{
+    const quint16 keep = ~quint16(0x1f | (0x1f << blueShift));
+    return (p & keep) | ((p >> blueShift) & 0x1f) | ((p & 0x1f) << blueShift);
+}
+
+#if defined(__SSE2__)
+static int swapRedBlue16_sse2(quint16 *dst, const quint16 *src, int count, int blueShift)
+{
+    const __m128i keep = _mm_set1_epi16(short(~(0x1f | (0x1f << blueShift))));
+    const __m128i lowBits = _mm_set1_epi16(0x1f);
+    const __m128i shift = _mm_cvtsi32_si128(blueShift);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        const __m128i red = _mm_and_si128(_mm_srl_epi16(p, shift), lowBits);
+        const __m128i blue = _mm_sll_epi16(_mm_and_si128(p, lowBits), shift);
+        const __m128i result = _mm_or_si128(_mm_and_si128(p, keep), _mm_or_si128(red, blue));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), result);
+    }
+    return i;
+}
+#elif defined(__ARM_NEON__)
+static int swapRedBlue16_neon(quint16 *dst, const quint16 *src, int count, int blueShift)
+{
+    const uint16x8_t keep = vdupq_n_u16(quint16(~(0x1f | (0x1f << blueShift))));
+    const uint16x8_t lowBits = vdupq_n_u16(0x1f);
+    const int16x8_t left = vdupq_n_s16(blueShift);
+    const int16x8_t right = vdupq_n_s16(-blueShift);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const uint16x8_t p = vld1q_u16(src + i);
+        const uint16x8_t red = vandq_u16(vshlq_u16(p, right), lowBits);
+        const uint16x8_t blue = vshlq_u16(vandq_u16(p, lowBits), left);
+        vst1q_u16(dst + i, vorrq_u16(vandq_u16(p, keep), vorrq_u16(red, blue)));
+    }
+    return i;
+}
+#endif
+
+static void swapRedBlue16(quint16 *dst, const quint16 *src, int count, int blueShift)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    i = swapRedBlue16_sse2(dst, src, count, blueShift);
+#elif defined(__ARM_NEON__)
+    i = swapRedBlue16_neon(dst, src, count, blueShift);
+#endif
+    for (; i < count; ++i)
+        dst[i] = swapRedBlue16(src[i], blueShift);
+}
+
+static void swapRedBlue32(quint32 *dst, const quint32 *src, int count)
+{
+    int i = 0;
+#if QT_COMPILER_SUPPORTS_HERE(AVX2)
+    if (qCpuHasFeature(AVX2))
+        i = swapRedBlue32_avx2(dst, src, count);
+#endif
+#if defined(__SSE2__)
+    i += swapRedBlue32_sse2(dst + i, src + i, count - i);
+#elif defined(__ARM_NEON__)
+    i += swapRedBlue32_neon(dst + i, src + i, count - i);
+#endif
+    for (; i < count; ++i)
+        dst[i] = swapRedBlue32(src[i]);
+}
+
+/*!
+    Writes the \a count pixels of \a src to \a dst with their red and blue
+    channels swapped, for a \a format qt_xcb_canSwapRedBlue() accepts.
+    \a dst and \a src may be the same, but may not otherwise overlap.
+*/
+void qt_xcb_swapRedBlue(QImage::Format format, uchar *dst, const uchar *src, int count)
+{
+    switch (format) {
+    case QImage::Format_RGB16:
+        swapRedBlue16(reinterpret_cast<quint16 *>(dst), reinterpret_cast<const quint16 *>(src), count, 11);
+        break;
+    case QImage::Format_RGB555:
+        swapRedBlue16(reinterpret_cast<quint16 *>(dst), reinterpret_cast<const quint16 *>(src), count, 10);
+        break;
+    default:
+        Q_ASSERT(qt_xcb_canSwapRedBlue(format));
+        swapRedBlue32(reinterpret_cast<quint32 *>(dst), reinterpret_cast<const quint32 *>(src), count);
+        break;
+    }
+}
+
 QT_END_NAMESPACE
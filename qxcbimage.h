@@ -41,6 +41,7 @@
 #define QXCBIMAGE_H
 
 #include "qxcbscreen.h"
+#include "qxcbbyteswap.h"
 #include <QtCore/QPair>
 #include <QtGui/QImage>
 #include <QtGui/QPixmap>
@@ -57,6 +58,9 @@ xcb_pixmap_t qt_xcb_XPixmapFromBitmap(QXcbScreen *screen, const QImage &image);
 xcb_cursor_t qt_xcb_createCursorXRender(QXcbScreen *screen, const QImage &image,
                                         const QPoint &spot);
 
+bool qt_xcb_canSwapRedBlue(QImage::Format format);
+void qt_xcb_swapRedBlue(QImage::Format format, uchar *dst, const uchar *src, int count);
+
 QT_END_NAMESPACE
 
 #endif
@@ -53,6 +53,11 @@
 
 QT_BEGIN_NAMESPACE
 
+// Quiet period after the last mapping notification before the keymap is
+// reloaded, and the longest a burst of notifications may delay the reload.
+static const int keymapUpdateDelay = 10;
+static const int keymapUpdateMaxDelay = 200;
+
 Qt::KeyboardModifiers QXcbKeyboard::translateModifiers(int s) const
 {
     Qt::KeyboardModifiers ret = Qt::NoModifier;
@@ -362,11 +367,27 @@ void QXcbKeyboard::updateKeymap(xcb_mapping_notify_event_t *event)
         return;
 
     xcb_refresh_keyboard_mapping(m_key_symbols, event);
-    updateKeymap();
+    scheduleKeymapUpdate();
+}
+
+void QXcbKeyboard::scheduleKeymapUpdate()
+{
+    // Tools like xmodmap and setxkbmap generate bursts of mapping notifications.
+    // Recompile the keymap once for the whole burst; key events that arrive in
+    // the meantime are translated with the previous keymap. Every notification
+    // restarts the quiet period, unless the burst has already gone on for so
+    // long that the reload must not be put off any further.
+    if (!m_keymapUpdateTimer.isActive())
+        m_keymapUpdateBurst.start();
+    else if (m_keymapUpdateBurst.elapsed() >= keymapUpdateMaxDelay)
+        return;
+    m_keymapUpdateTimer.start();
 }
 
 void QXcbKeyboard::updateKeymap()
 {
+    m_translationCache.clear();
+
     KeysymModifierMap keysymMods;
     if (!connection()->hasXKB())
         keysymMods = keysymsToModifiers();
@@ -527,9 +548,14 @@ void QXcbKeyboard::updateXKBMods()
 QXcbKeyboard::QXcbKeyboard(QXcbConnection *connection)
     : QXcbObject(connection)
 {
+    m_keymapUpdateTimer.setSingleShot(true);
+    m_keymapUpdateTimer.setInterval(keymapUpdateDelay);
+    m_keymapUpdateTimer.callOnTimeout([this]() { updateKeymap(); });
+
     core_device_id = 0;
     if (connection->hasXKB()) {
         selectEvents();
+        enableDetectableAutoRepeat();
         core_device_id = xkb_x11_get_core_keyboard_device_id(xcb_connection());
         if (core_device_id == -1) {
             qCWarning(lcQpaXcb, "failed to get core keyboard device info");
@@ -588,6 +614,19 @@ void QXcbKeyboard::selectEvents()
     }
 }
 
+void QXcbKeyboard::enableDetectableAutoRepeat()
+{
+    // With detectable auto-repeat the server does not generate the synthetic
+    // KeyRelease events in between repeated KeyPress events, so there is no
+    // need to peek into the event queue to tell repeats from real releases.
+    const uint32_t flag = XCB_XKB_PER_CLIENT_FLAG_DETECTABLE_AUTO_REPEAT;
+    auto reply = Q_XCB_REPLY(xcb_xkb_per_client_flags, xcb_connection(),
+                             XCB_XKB_ID_USE_CORE_KBD, flag, flag, 0, 0, 0);
+    m_hasDetectableAutoRepeat = reply && (reply->supported & flag) && (reply->value & flag);
+    if (!m_hasDetectableAutoRepeat)
+        qCDebug(lcQpaKeyboard, "detectable auto-repeat is not supported, falling back to queue inspection");
+}
+
 void QXcbKeyboard::updateVModMapping()
 {
     xcb_xkb_get_names_value_list_t names_list;
@@ -859,6 +898,37 @@ void QXcbKeyboard::resolveMaskConflicts()
         m_hyperAsMeta = true;
 }
 
+const QXcbKeyboard::KeyTranslation &QXcbKeyboard::translateKey(struct xkb_state *xkbState,
+                                                                xcb_keycode_t code, quint16 state)
+{
+    // The result only depends on the keymap, the effective layout and modifiers
+    // of the xkb state and the core modifier bits of the event, so key presses
+    // and auto-repeat floods can be served without going through libxkbcommon.
+    const xkb_mod_mask_t mods = xkb_state_serialize_mods(xkbState, XKB_STATE_MODS_EFFECTIVE);
+    const xkb_layout_index_t layout = xkb_state_serialize_layout(xkbState, XKB_STATE_LAYOUT_EFFECTIVE);
+    const quint64 pageKey = quint64(mods) | quint64(state & 0xff) << 32 | quint64(layout & 0xff) << 40;
+
+    QVector<KeyTranslation> &page = m_translationCache[pageKey];
+    if (page.isEmpty())
+        page.resize(256);
+
+    KeyTranslation &translation = page[code];
+    if (translation.valid)
+        return translation;
+
+    translation.sym = xkb_state_key_get_one_sym(xkbState, code);
+    translation.text = QXkbCommon::lookupString(xkbState, code);
+
+    translation.modifiers = translateModifiers(state);
+    if (QXkbCommon::isKeypad(translation.sym))
+        translation.modifiers |= Qt::KeypadModifier;
+
+    translation.qtKey = QXkbCommon::keysymToQtKey(translation.sym, translation.modifiers, xkbState,
+                                                  code, m_superAsMeta, m_hyperAsMeta);
+    translation.valid = true;
+    return translation;
+}
+
 void QXcbKeyboard::handleKeyEvent(xcb_window_t sourceWindow, QEvent::Type type, xcb_keycode_t code,
                                   quint16 state, xcb_timestamp_t time, bool fromSendEvent)
 {
@@ -888,16 +958,28 @@ void QXcbKeyboard::handleKeyEvent(xcb_window_t sourceWindow, QEvent::Type type,
 
     struct xkb_state *xkbState = fromSendEvent ? sendEventState.get() : m_xkbState.get();
 
-    xcb_keysym_t sym = xkb_state_key_get_one_sym(xkbState, code);
-    QString text = QXkbCommon::lookupString(xkbState, code);
-
-    Qt::KeyboardModifiers modifiers = translateModifiers(state);
-    if (QXkbCommon::isKeypad(sym))
-        modifiers |= Qt::KeypadModifier;
-
-    int qtcode = QXkbCommon::keysymToQtKey(sym, modifiers, xkbState, code, m_superAsMeta, m_hyperAsMeta);
-
-    if (type == QEvent::KeyPress) {
+    const KeyTranslation &translation = translateKey(xkbState, code, state);
+    const xcb_keysym_t sym = translation.sym;
+    const QString text = translation.text;
+    const Qt::KeyboardModifiers modifiers = translation.modifiers;
+    const int qtcode = translation.qtKey;
+
+    if (m_hasDetectableAutoRepeat && !fromSendEvent) {
+        // The server only repeats the key that was pressed last, and reports the
+        // repeats as KeyPress events without any KeyRelease in between.
+        if (type == QEvent::KeyPress) {
+            m_isAutoRepeat = m_autoRepeatCode == code;
+            m_autoRepeatCode = code;
+            // Keep delivering repeats as release/press pairs, like the fallback below does.
+            if (m_isAutoRepeat)
+                deliverKeyEvent(targetWindow, QEvent::KeyRelease, qtcode, modifiers, code, sym,
+                                state, text, time);
+        } else {
+            m_isAutoRepeat = false;
+            if (m_autoRepeatCode == code)
+                m_autoRepeatCode = 0;
+        }
+    } else if (type == QEvent::KeyPress) {
         if (m_isAutoRepeat && m_autoRepeatCode != code)
             // Some other key was pressed while we are auto-repeating on a different key.
             m_isAutoRepeat = false;
@@ -916,6 +998,14 @@ void QXcbKeyboard::handleKeyEvent(xcb_window_t sourceWindow, QEvent::Type type,
         });
     }
 
+    deliverKeyEvent(targetWindow, type, qtcode, modifiers, code, sym, state, text, time);
+}
+
+void QXcbKeyboard::deliverKeyEvent(QXcbWindow *targetWindow, QEvent::Type type, int qtcode,
+                                   Qt::KeyboardModifiers modifiers, xcb_keycode_t code,
+                                   xcb_keysym_t sym, quint16 state, const QString &text,
+                                   xcb_timestamp_t time)
+{
     bool filtered = false;
     if (auto inputContext = QGuiApplicationPrivate::platformIntegration()->inputContext()) {
         QKeyEvent event(type, qtcode, modifiers, code, sym, state, text, m_isAutoRepeat, text.size());
@@ -51,6 +51,10 @@
 #include <xkbcommon/xkbcommon-x11.h>
 
 #include <QEvent>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QVector>
 
 QT_BEGIN_NAMESPACE
 
@@ -63,6 +67,8 @@ public:
 
     void initialize();
     void selectEvents();
+    void enableDetectableAutoRepeat();
+    void resetAutoRepeat() { m_isAutoRepeat = false; m_autoRepeatCode = 0; }
 
     void handleKeyPressEvent(const xcb_key_press_event_t *event);
     void handleKeyReleaseEvent(const xcb_key_release_event_t *event);
@@ -70,6 +76,7 @@ public:
     Qt::KeyboardModifiers translateModifiers(int s) const;
     void updateKeymap(xcb_mapping_notify_event_t *event);
     void updateKeymap();
+    void scheduleKeymapUpdate();
     QList<int> possibleKeys(const QKeyEvent *event) const;
 
     void updateXKBMods();
@@ -85,6 +92,9 @@ public:
 protected:
     void handleKeyEvent(xcb_window_t sourceWindow, QEvent::Type type, xcb_keycode_t code,
                         quint16 state, xcb_timestamp_t time, bool fromSendEvent);
+    void deliverKeyEvent(QXcbWindow *targetWindow, QEvent::Type type, int qtcode,
+                         Qt::KeyboardModifiers modifiers, xcb_keycode_t code, xcb_keysym_t sym,
+                         quint16 state, const QString &text, xcb_timestamp_t time);
 
     void resolveMaskConflicts();
 
@@ -97,10 +107,20 @@ protected:
     void updateVModMapping();
     void updateVModToRModMapping();
 
+    struct KeyTranslation {
+        xcb_keysym_t sym = XKB_KEY_NoSymbol;
+        int qtKey = 0;
+        Qt::KeyboardModifiers modifiers;
+        QString text;
+        bool valid = false;
+    };
+    const KeyTranslation &translateKey(struct xkb_state *xkbState, xcb_keycode_t code, quint16 state);
+
 private:
     bool m_config = false;
     bool m_isAutoRepeat = false;
     xcb_keycode_t m_autoRepeatCode = 0;
+    bool m_hasDetectableAutoRepeat = false;
 
     struct _mod_masks {
         uint alt;
@@ -132,6 +152,13 @@ private:
     QXkbCommon::ScopedXKBKeymap m_xkbKeymap;
     QXkbCommon::ScopedXKBContext m_xkbContext;
 
+    // Translations of (layout, modifier state) pages, each indexed by keycode.
+    // Filled in lazily and dropped whenever the keymap changes.
+    QHash<quint64, QVector<KeyTranslation>> m_translationCache;
+
+    QTimer m_keymapUpdateTimer;
+    QElapsedTimer m_keymapUpdateBurst;
+
     bool m_superAsMeta = false;
     bool m_hyperAsMeta = false;
 };
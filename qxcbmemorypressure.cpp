@@ -0,0 +1,227 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qxcbmemorypressure.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QSocketNotifier>
+#include <QtCore/private/qcore_unix_p.h>
+
+#include <string.h>
+
+#include <algorithm>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+    \class QXcbMemoryPressure
+    \internal
+
+    Asks the subsystems of the plugin which hold on to memory, like the
+    shared memory of the backing stores or the cursor caches, to give back
+    what they can when the system is short of memory. Pressure is detected
+    with a Linux PSI trigger on the memory.pressure file of our cgroup or on
+    /proc/pressure/memory, or failing that by watching the high, max and oom
+    counters of the memory.events file of our cgroup. The bytes released are
+    accounted per subsystem. Set QT_XCB_NO_MEMORY_PRESSURE to disable it.
+*/
+
+// Trim once tasks were stalled on memory for 150 ms within 2 s; windows
+// which are a multiple of 2 s are also allowed to unprivileged processes
+static const char PressureTrigger[] = "some 150000 2000000";
+
+// Don't trim again while the caches are still being rebuilt
+static const qint64 MinTrimIntervalMs = 5000;
+
+static QByteArray cgroupDirectory()
+{
+    QFile file(QStringLiteral("/proc/self/cgroup"));
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+
+    // The unified hierarchy is the only one with an empty controller list
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    for (const QByteArray &line : lines) {
+        if (line.startsWith("0::"))
+            return QByteArrayLiteral("/sys/fs/cgroup") + line.mid(3);
+    }
+    return QByteArray();
+}
+
+QXcbMemoryPressure::QXcbMemoryPressure(QXcbConnection *connection)
+    : QXcbObject(connection)
+{
+    if (qEnvironmentVariableIsSet("QT_XCB_NO_MEMORY_PRESSURE"))
+        return;
+
+    QByteArray cgroup = cgroupDirectory();
+    if (cgroup.endsWith('/'))
+        cgroup.chop(1);
+
+    const bool watching = (!cgroup.isEmpty() && watchPressure(cgroup + "/memory.pressure"))
+            || watchPressure(QByteArrayLiteral("/proc/pressure/memory"))
+            || (!cgroup.isEmpty() && watchEvents(cgroup + "/memory.events"));
+    if (!watching) {
+        qCDebug(lcQpaXcb, "memory pressure: neither PSI nor cgroup memory events available");
+        return;
+    }
+
+    m_notifier.reset(new QSocketNotifier(m_fd, QSocketNotifier::Exception));
+    QObject::connect(m_notifier.data(), &QSocketNotifier::activated,
+                     [this]() { handleNotification(); });
+}
+
+QXcbMemoryPressure::~QXcbMemoryPressure()
+{
+    m_notifier.reset();
+    if (m_fd != -1)
+        qt_safe_close(m_fd);
+}
+
+/*!
+    Registers \a trimmer to be asked to give back memory under pressure,
+    with the bytes it releases accounted to \a subsystem. Shared pools,
+    which the other subsystems give their memory back to, are trimmed after
+    all the others.
+*/
+void QXcbMemoryPressure::addTrimmer(const char *subsystem, QXcbMemoryTrimmer *trimmer, bool sharedPool)
+{
+    m_trimmers.append({ subsystem, trimmer, sharedPool });
+}
+
+void QXcbMemoryPressure::removeTrimmer(QXcbMemoryTrimmer *trimmer)
+{
+    m_trimmers.erase(std::remove_if(m_trimmers.begin(), m_trimmers.end(),
+                                    [trimmer](const Trimmer &t) { return t.trimmer == trimmer; }),
+                     m_trimmers.end());
+}
+
+void QXcbMemoryPressure::trim()
+{
+    if (m_lastTrim.isValid() && !m_lastTrim.hasExpired(MinTrimIntervalMs))
+        return;
+    m_lastTrim.start();
+
+    QHash<QByteArray, qint64> released;
+    for (bool sharedPools : { false, true }) {
+        for (int i = 0; i < m_trimmers.size(); ++i) {
+            const Trimmer trimmer = m_trimmers.at(i);
+            if (trimmer.sharedPool == sharedPools)
+                released[trimmer.subsystem] += trimmer.trimmer->trimMemory();
+        }
+    }
+    // Hand the freed server-side resources back right away
+    connection()->flush();
+
+    for (auto it = released.cbegin(); it != released.cend(); ++it) {
+        qint64 &total = m_reclaimedBytes[it.key()];
+        total += it.value();
+        qCDebug(lcQpaXcb) << "memory pressure:" << it.key().constData() << "released"
+                          << it.value() << "bytes," << total << "in total";
+    }
+}
+
+bool QXcbMemoryPressure::watchPressure(const QByteArray &path)
+{
+    const int fd = qt_safe_open(path.constData(), O_RDWR | O_NONBLOCK);
+    if (fd == -1)
+        return false;
+
+    // The trigger is registered by writing it, including the terminating null
+    if (qt_safe_write(fd, PressureTrigger, sizeof(PressureTrigger)) < 0) {
+        qCDebug(lcQpaXcb, "memory pressure: cannot set a trigger on %s: %s",
+                path.constData(), strerror(errno));
+        qt_safe_close(fd);
+        return false;
+    }
+
+    qCDebug(lcQpaXcb, "memory pressure: watching %s", path.constData());
+    m_fd = fd;
+    return true;
+}
+
+bool QXcbMemoryPressure::watchEvents(const QByteArray &path)
+{
+    const int fd = qt_safe_open(path.constData(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    qCDebug(lcQpaXcb, "memory pressure: watching %s", path.constData());
+    m_fd = fd;
+    m_watchingEvents = true;
+    m_eventCount = readEventCount();
+    return true;
+}
+
+/*!
+    Returns how often the memory of our cgroup went over its high or max
+    limit, or ran out, so far.
+*/
+quint64 QXcbMemoryPressure::readEventCount() const
+{
+    char buffer[512];
+    const ssize_t size = ::pread(m_fd, buffer, sizeof(buffer) - 1, 0);
+    if (size <= 0)
+        return m_eventCount;
+
+    quint64 count = 0;
+    const QList<QByteArray> lines = QByteArray(buffer, int(size)).split('\n');
+    for (const QByteArray &line : lines) {
+        const int space = line.indexOf(' ');
+        const QByteArray key = line.left(space);
+        if (key == "high" || key == "max" || key == "oom")
+            count += line.mid(space + 1).toULongLong();
+    }
+    return count;
+}
+
+void QXcbMemoryPressure::handleNotification()
+{
+    if (m_watchingEvents) {
+        // The file also changes for events we don't care about
+        const quint64 eventCount = readEventCount();
+        if (eventCount <= m_eventCount)
+            return;
+        m_eventCount = eventCount;
+    }
+
+    trim();
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,99 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QXCBMEMORYPRESSURE_H
+#define QXCBMEMORYPRESSURE_H
+
+#include "qxcbobject.h"
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QVector>
+
+QT_BEGIN_NAMESPACE
+
+class QSocketNotifier;
+
+class QXcbMemoryTrimmer
+{
+public:
+    virtual ~QXcbMemoryTrimmer() {}
+
+    // Frees what can be rebuilt later, returns the number of bytes released
+    virtual qint64 trimMemory() = 0;
+};
+
+class QXcbMemoryPressure : public QXcbObject
+{
+public:
+    QXcbMemoryPressure(QXcbConnection *connection);
+    ~QXcbMemoryPressure();
+
+    void addTrimmer(const char *subsystem, QXcbMemoryTrimmer *trimmer, bool sharedPool = false);
+    void removeTrimmer(QXcbMemoryTrimmer *trimmer);
+
+    void trim();
+
+    qint64 reclaimedBytes(const char *subsystem) const { return m_reclaimedBytes.value(subsystem); }
+
+private:
+    bool watchPressure(const QByteArray &path);
+    bool watchEvents(const QByteArray &path);
+    quint64 readEventCount() const;
+    void handleNotification();
+
+    struct Trimmer {
+        const char *subsystem;
+        QXcbMemoryTrimmer *trimmer;
+        bool sharedPool;
+    };
+    QVector<Trimmer> m_trimmers;
+    QHash<QByteArray, qint64> m_reclaimedBytes;
+
+    int m_fd = -1;
+    bool m_watchingEvents = false;
+    quint64 m_eventCount = 0;
+    QScopedPointer<QSocketNotifier> m_notifier;
+    QElapsedTimer m_lastTrim;
+};
+
+QT_END_NAMESPACE
+
+#endif
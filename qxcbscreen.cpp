@@ -117,6 +117,9 @@ QXcbVirtualDesktop::QXcbVirtualDesktop(QXcbConnection *connection, xcb_screen_t
 QXcbVirtualDesktop::~QXcbVirtualDesktop()
 {
     delete m_xSettings;
+
+    for (xcb_colormap_t colormap : qAsConst(m_colormaps))
+        xcb_free_colormap(xcb_connection(), colormap);
 }
 
 QDpi QXcbVirtualDesktop::dpi() const
@@ -479,6 +482,23 @@ quint8 QXcbVirtualDesktop::depthOfVisual(xcb_visualid_t visualid) const
     return *it;
 }
 
+/*!
+    Returns a colormap for windows with \a visualId, which all of them share.
+    It is created the first time it is asked for, without a round-trip.
+*/
+xcb_colormap_t QXcbVirtualDesktop::colormapForVisual(xcb_visualid_t visualId)
+{
+    if (visualId == m_screen->root_visual)
+        return m_screen->default_colormap;
+
+    xcb_colormap_t &colormap = m_colormaps[visualId];
+    if (!colormap) {
+        colormap = xcb_generate_id(xcb_connection());
+        xcb_create_colormap(xcb_connection(), XCB_COLORMAP_ALLOC_NONE, colormap, m_screen->root, visualId);
+    }
+    return colormap;
+}
+
 QXcbScreen::QXcbScreen(QXcbConnection *connection, QXcbVirtualDesktop *virtualDesktop,
                        xcb_randr_output_t outputId, xcb_randr_get_output_info_reply_t *output,
                        const xcb_xinerama_screen_info_t *xineramaScreenInfo, int xineramaScreenIdx)
@@ -768,6 +788,7 @@ void QXcbScreen::updateRefreshRate(xcb_randr_mode_t mode)
                 const uint32_t dotCount = modeInfo->htotal * modeInfo->vtotal;
                 m_refreshRate = (dotCount != 0) ? modeInfo->dot_clock / qreal(dotCount) : 0;
                 m_mode = mode;
+                m_frameClock.setRefreshRate(m_refreshRate);
                 break;
             }
         }
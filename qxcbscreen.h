@@ -48,6 +48,7 @@
 #include <xcb/xfixes.h>
 #include <xcb/xinerama.h>
 
+#include "qxcbframeclock.h"
 #include "qxcbobject.h"
 #include "qxcbscreen.h"
 
@@ -106,6 +107,7 @@ public:
     const xcb_visualtype_t *visualForFormat(const QSurfaceFormat &format) const;
     const xcb_visualtype_t *visualForId(xcb_visualid_t) const;
     quint8 depthOfVisual(xcb_visualid_t) const;
+    xcb_colormap_t colormapForVisual(xcb_visualid_t visualId);
 
 private:
     QRect getWorkArea() const;
@@ -132,6 +134,7 @@ private:
     QString m_windowManagerName;
     QMap<xcb_visualid_t, xcb_visualtype_t> m_visuals;
     QMap<xcb_visualid_t, quint8> m_visualDepths;
+    QHash<xcb_visualid_t, xcb_colormap_t> m_colormaps;
     uint16_t m_rotation = 0;
 };
 
@@ -198,6 +201,8 @@ public:
     void updateAvailableGeometry();
     void updateRefreshRate(xcb_randr_mode_t mode);
 
+    QXcbFrameClock *frameClock() { return &m_frameClock; }
+
     QFontEngine::HintStyle hintStyle() const { return m_virtualDesktop->hintStyle(); }
     QFontEngine::SubpixelAntialiasingType subpixelType() const { return m_virtualDesktop->subpixelType(); }
     int antialiasingEnabled() const { return m_virtualDesktop->antialiasingEnabled(); }
@@ -224,6 +229,7 @@ private:
     Qt::ScreenOrientation m_orientation = Qt::PrimaryOrientation;
     QXcbCursor *m_cursor;
     qreal m_refreshRate = 60.0;
+    QXcbFrameClock m_frameClock;
 };
 
 #ifndef QT_NO_DEBUG_STREAM
@@ -0,0 +1,278 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qxcbshmarena.h"
+#include "qxcbbackingstore.h"
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/mman.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <algorithm>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+    \class QXcbShmArena
+    \internal
+
+    Sub-allocates backing store memory out of a few MIT-SHM segments that stay
+    attached to the server. Blocks up to LargeBlockSize are handed out in power
+    of two size classes, starting at MinBlockSize, and carved out of shared
+    segments. Larger blocks are only rounded up to LargeBlockGranularity, so that
+    a full screen image doesn't take twice its size, and get a segment of their
+    own. Released blocks go to a free list and are reused without any server
+    round-trip; segments without live blocks are detached once more than
+    MaxIdleBytes of them pile up, or when trim() is called.
+*/
+
+enum : size_t {
+    MinBlockSize = 64 * 1024,
+    SegmentSize = 16 * 1024 * 1024,
+    LargeBlockSize = SegmentSize / 4,
+    LargeBlockGranularity = 2 * 1024 * 1024, // huge page size
+    MaxIdleBytes = 2 * SegmentSize
+};
+
+static int sizeClassForSize(size_t size)
+{
+    int sizeClass = 0;
+    while ((size_t(MinBlockSize) << sizeClass) < size)
+        ++sizeClass;
+    return sizeClass;
+}
+
+static size_t blockSizeForSize(size_t size)
+{
+    if (size > LargeBlockSize)
+        return (size + LargeBlockGranularity - 1) & ~size_t(LargeBlockGranularity - 1);
+    return size_t(MinBlockSize) << sizeClassForSize(size);
+}
+
+QXcbShmArena::QXcbShmArena(QXcbConnection *connection)
+    : QXcbObject(connection)
+{
+    connection->memoryPressure()->addTrimmer("shm segments", this, true);
+}
+
+QXcbShmArena::~QXcbShmArena()
+{
+    connection()->memoryPressure()->removeTrimmer(this);
+    for (const Segment &segment : qAsConst(m_segments))
+        destroySegment(segment);
+}
+
+QXcbShmArena::Block QXcbShmArena::allocate(size_t size)
+{
+    Q_ASSERT(connection()->hasShm());
+
+    if (size == 0)
+        return Block();
+
+    const size_t blockSize = blockSizeForSize(size);
+
+    int freeIndex = -1;
+    QVector<FreeBlock> *freeBlocks = nullptr;
+    if (blockSize > LargeBlockSize) {
+        // Take the smallest large block that fits without wasting much of it
+        freeBlocks = &m_freeLargeBlocks;
+        for (int i = 0; i < freeBlocks->size(); ++i) {
+            const size_t freeSize = freeBlocks->at(i).block.size;
+            if (freeSize >= blockSize && freeSize - blockSize <= blockSize / 8
+                    && (freeIndex < 0 || freeSize < freeBlocks->at(freeIndex).block.size)) {
+                freeIndex = i;
+            }
+        }
+    } else {
+        const int sizeClass = sizeClassForSize(blockSize);
+        if (m_freeBlocks.size() <= sizeClass)
+            m_freeBlocks.resize(sizeClass + 1);
+        freeBlocks = &m_freeBlocks[sizeClass];
+        freeIndex = freeBlocks->size() - 1;
+    }
+
+    if (freeIndex >= 0) {
+        const FreeBlock freeBlock = freeBlocks->takeAt(freeIndex);
+        // The server might still be reading from the block on behalf of its previous owner
+        if (freeBlock.lastUseSequence)
+            connection()->waitForRequest(freeBlock.lastUseSequence);
+        m_segments[freeBlock.block.shmseg].liveBlocks++;
+        return freeBlock.block;
+    }
+
+    Segment *segment = nullptr;
+    if (blockSize <= LargeBlockSize) {
+        auto it = m_segments.find(m_openSegment);
+        if (it != m_segments.end() && it->used + blockSize <= it->size) {
+            segment = &it.value();
+        } else {
+            segment = createSegment(SegmentSize);
+            if (segment)
+                m_openSegment = segment->info.shmseg;
+        }
+    } else {
+        segment = createSegment(blockSize);
+    }
+
+    if (!segment)
+        return Block();
+
+    Block block;
+    block.shmseg = segment->info.shmseg;
+    block.shmaddr = segment->info.shmaddr;
+    block.offset = segment->used;
+    block.size = blockSize;
+
+    segment->used += blockSize;
+    segment->liveBlocks++;
+
+    return block;
+}
+
+void QXcbShmArena::release(const Block &block, uint lastUseSequence)
+{
+    if (!block.isValid())
+        return;
+
+    auto it = m_segments.find(block.shmseg);
+    Q_ASSERT(it != m_segments.end());
+    it->liveBlocks--;
+
+    if (block.size > LargeBlockSize) {
+        m_freeLargeBlocks.append({ block, lastUseSequence });
+    } else {
+        const int sizeClass = sizeClassForSize(block.size);
+        if (m_freeBlocks.size() <= sizeClass)
+            m_freeBlocks.resize(sizeClass + 1);
+        m_freeBlocks[sizeClass].append({ block, lastUseSequence });
+    }
+
+    trim(MaxIdleBytes);
+}
+
+/*!
+    Detaches segments without live blocks until at most \a keepBytes of them
+    remain, and returns the number of bytes released.
+*/
+size_t QXcbShmArena::trim(size_t keepBytes)
+{
+    size_t idleBytes = 0;
+    for (const Segment &segment : qAsConst(m_segments)) {
+        if (segment.liveBlocks == 0)
+            idleBytes += segment.size;
+    }
+
+    size_t releasedBytes = 0;
+    for (auto it = m_segments.begin(); it != m_segments.end() && idleBytes > keepBytes;) {
+        if (it->liveBlocks != 0) {
+            ++it;
+            continue;
+        }
+
+        const xcb_shm_seg_t shmseg = it.key();
+        const auto dropSegmentBlocks = [shmseg](QVector<FreeBlock> &freeBlocks) {
+            freeBlocks.erase(std::remove_if(freeBlocks.begin(), freeBlocks.end(),
+                                            [shmseg](const FreeBlock &freeBlock) {
+                                                return freeBlock.block.shmseg == shmseg;
+                                            }),
+                             freeBlocks.end());
+        };
+        for (QVector<FreeBlock> &freeBlocks : m_freeBlocks)
+            dropSegmentBlocks(freeBlocks);
+        dropSegmentBlocks(m_freeLargeBlocks);
+        if (m_openSegment == shmseg)
+            m_openSegment = 0;
+
+        idleBytes -= it->size;
+        releasedBytes += it->size;
+        destroySegment(it.value());
+        it = m_segments.erase(it);
+    }
+
+    return releasedBytes;
+}
+
+QXcbShmArena::Segment *QXcbShmArena::createSegment(size_t size)
+{
+    Segment segment;
+    memset(&segment.info, 0, sizeof segment.info);
+    segment.size = size;
+
+    if (connection()->hasShmFd()) {
+        // Huge pages are opt-in, as they need pages reserved by the administrator
+        static const bool useHugePages = qEnvironmentVariableIsSet("QT_XCB_SHM_HUGETLB");
+        const bool hugePages = useHugePages && size % LargeBlockGranularity == 0;
+        segment.isMemfd = QXcbBackingStore::createMemfdShmSegment(xcb_connection(), size,
+                                                                  &segment.info, hugePages);
+    }
+    if (!segment.isMemfd && !QXcbBackingStore::createSystemVShmSegment(xcb_connection(), size,
+                                                                        &segment.info)) {
+        return nullptr;
+    }
+
+    qCDebug(lcQpaXcb) << "attached" << (segment.isMemfd ? "memfd" : "System V")
+                      << "SHM segment of" << size << "bytes";
+
+    return &m_segments.insert(segment.info.shmseg, segment).value();
+}
+
+void QXcbShmArena::destroySegment(const Segment &segment)
+{
+    // The server processes the detach after any put still reading from the segment
+    xcb_shm_detach(xcb_connection(), segment.info.shmseg);
+
+    if (segment.isMemfd) {
+        if (munmap(segment.info.shmaddr, segment.size) == -1) {
+            qCWarning(lcQpaXcb, "munmap() failed (%d: %s) for %p with size %zu",
+                      errno, strerror(errno), segment.info.shmaddr, segment.size);
+        }
+    } else {
+        if (shmdt(segment.info.shmaddr) == -1) {
+            qCWarning(lcQpaXcb, "shmdt() failed (%d: %s) for %p",
+                      errno, strerror(errno), segment.info.shmaddr);
+        }
+    }
+
+    qCDebug(lcQpaXcb) << "detached SHM segment of" << segment.size << "bytes";
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,102 @@
+/****************************************************************************
+**
+** Copyright (C) 2016 The Qt Company Ltd.
+** Contact: https://www.qt.io/licensing/
+**
+** This file is part of the plugins of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms
+** and conditions see https://www.qt.io/terms-conditions. For further
+** information use the contact form at https://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 3 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL3 included in the
+** packaging of this file. Please review the following information to
+** ensure the GNU Lesser General Public License version 3 requirements
+** will be met: https://www.gnu.org/licenses/lgpl-3.0.html.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 2.0 or (at your option) the GNU General
+** Public license version 3 or any later version approved by the KDE Free
+** Qt Foundation. The licenses are as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL2 and LICENSE.GPL3
+** included in the packaging of this file. Please review the following
+** information to ensure the GNU General Public License requirements will
+** be met: https://www.gnu.org/licenses/gpl-2.0.html and
+** https://www.gnu.org/licenses/gpl-3.0.html.
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QXCBSHMARENA_H
+#define QXCBSHMARENA_H
+
+#include "qxcbobject.h"
+#include "qxcbmemorypressure.h"
+
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+#include <xcb/shm.h>
+
+QT_BEGIN_NAMESPACE
+
+class QXcbShmArena : public QXcbObject, public QXcbMemoryTrimmer
+{
+public:
+    struct Block {
+        xcb_shm_seg_t shmseg = 0;
+        quint8 *shmaddr = nullptr; // base address of the segment
+        uint32_t offset = 0;
+        size_t size = 0;
+
+        bool isValid() const { return shmaddr != nullptr; }
+        quint8 *data() const { return shmaddr + offset; }
+    };
+
+    QXcbShmArena(QXcbConnection *connection);
+    ~QXcbShmArena();
+
+    Block allocate(size_t size);
+    void release(const Block &block, uint lastUseSequence = 0);
+
+    size_t trim(size_t keepBytes = 0);
+    qint64 trimMemory() override { return qint64(trim(0)); }
+
+private:
+    struct Segment {
+        xcb_shm_segment_info_t info;
+        size_t size = 0;
+        size_t used = 0;
+        int liveBlocks = 0;
+        bool isMemfd = false;
+    };
+
+    struct FreeBlock {
+        Block block;
+        uint lastUseSequence;
+    };
+
+    Segment *createSegment(size_t size);
+    void destroySegment(const Segment &segment);
+
+    QHash<xcb_shm_seg_t, Segment> m_segments;
+    xcb_shm_seg_t m_openSegment = 0;
+
+    // Released blocks, by size class, and those of their own segment
+    QVector<QVector<FreeBlock>> m_freeBlocks;
+    QVector<FreeBlock> m_freeLargeBlocks;
+};
+
+QT_END_NAMESPACE
+
+#endif
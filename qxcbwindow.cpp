@@ -43,6 +43,7 @@
 #include <QMetaEnum>
 #include <QScreen>
 #include <QtGui/QRegion>
+#include <QtCore/QDeadlineTimer>
 #include <QtGui/private/qhighdpiscaling_p.h>
 
 #include "qxcbintegration.h"
@@ -244,7 +245,8 @@ QXcbWindow::QXcbWindow(QWindow *window)
 enum : quint32 {
     baseEventMask
         = XCB_EVENT_MASK_EXPOSURE | XCB_EVENT_MASK_STRUCTURE_NOTIFY
-            | XCB_EVENT_MASK_PROPERTY_CHANGE | XCB_EVENT_MASK_FOCUS_CHANGE,
+            | XCB_EVENT_MASK_PROPERTY_CHANGE | XCB_EVENT_MASK_FOCUS_CHANGE
+            | XCB_EVENT_MASK_VISIBILITY_CHANGE,
 
     defaultEventMask = baseEventMask
             | XCB_EVENT_MASK_KEY_PRESS | XCB_EVENT_MASK_KEY_RELEASE
@@ -253,7 +255,7 @@ enum : quint32 {
             | XCB_EVENT_MASK_POINTER_MOTION,
 
     transparentForInputEventMask = baseEventMask
-            | XCB_EVENT_MASK_VISIBILITY_CHANGE | XCB_EVENT_MASK_RESIZE_REDIRECT
+            | XCB_EVENT_MASK_RESIZE_REDIRECT
             | XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT
             | XCB_EVENT_MASK_COLOR_MAP_CHANGE | XCB_EVENT_MASK_OWNER_GRAB_BUTTON
 };
@@ -355,13 +357,7 @@ void QXcbWindow::create()
     };
 
     if ((window()->supportsOpenGL() && haveOpenGL()) || m_format.hasAlpha()) {
-        m_cmap = xcb_generate_id(xcb_connection());
-        xcb_create_colormap(xcb_connection(),
-                            XCB_COLORMAP_ALLOC_NONE,
-                            m_cmap,
-                            xcb_parent_id,
-                            m_visualId);
-
+        m_cmap = platformScreen->virtualDesktop()->colormapForVisual(m_visualId);
         mask |= XCB_CW_COLORMAP;
     }
 
@@ -376,19 +372,20 @@ void QXcbWindow::create()
     };
 
     m_window = xcb_generate_id(xcb_connection());
-    xcb_create_window(xcb_connection(),
-                      m_depth,
-                      m_window,                        // window id
-                      xcb_parent_id,                   // parent window id
-                      rect.x(),
-                      rect.y(),
-                      rect.width(),
-                      rect.height(),
-                      0,                               // border width
-                      XCB_WINDOW_CLASS_INPUT_OUTPUT,   // window class
-                      m_visualId,                      // visual
-                      mask,
-                      values);
+    const xcb_void_cookie_t createCookie =
+            xcb_create_window(xcb_connection(),
+                              m_depth,
+                              m_window,                        // window id
+                              xcb_parent_id,                   // parent window id
+                              rect.x(),
+                              rect.y(),
+                              rect.width(),
+                              rect.height(),
+                              0,                               // border width
+                              XCB_WINDOW_CLASS_INPUT_OUTPUT,   // window class
+                              m_visualId,                      // visual
+                              mask,
+                              values);
 
     connection()->addWindowEventListener(m_window, this);
 
@@ -424,18 +421,39 @@ void QXcbWindow::create()
                             XCB_ATOM_STRING, 8, wmClass.size(), wmClass.constData());
     }
 
+    m_obscured = false;
+    m_hidden = false;
+
+    m_extendedSyncCounter = 0;
+    m_extendedSyncValue = 0;
+    m_syncRequestIsExtended = false;
+    m_frameDrawnPending = false;
+    m_frameDrawnSeen = false;
+    m_frameRecords.clear();
+
     if (connection()->hasXSync()) {
         m_syncCounter = xcb_generate_id(xcb_connection());
         xcb_sync_create_counter(xcb_connection(), m_syncCounter, m_syncValue);
 
+        // Only windows drawn through the backing store report their frames,
+        // the window manager would wait for the others in vain.
+        xcb_sync_counter_t counters[2] = { m_syncCounter, XCB_NONE };
+        int counterCount = 1;
+        if (window()->surfaceType() == QSurface::RasterSurface
+                || window()->surfaceType() == QSurface::RasterGLSurface) {
+            m_extendedSyncCounter = xcb_generate_id(xcb_connection());
+            xcb_sync_create_counter(xcb_connection(), m_extendedSyncCounter, m_syncValue);
+            counters[counterCount++] = m_extendedSyncCounter;
+        }
+
         xcb_change_property(xcb_connection(),
                             XCB_PROP_MODE_REPLACE,
                             m_window,
                             atom(QXcbAtom::_NET_WM_SYNC_REQUEST_COUNTER),
                             XCB_ATOM_CARDINAL,
                             32,
-                            1,
-                            &m_syncCounter);
+                            counterCount,
+                            counters);
     }
 
     // set the PID to let the WM kill the application if unresponsive
@@ -452,11 +470,18 @@ void QXcbWindow::create()
     }
 
     // Create WM_HINTS property on the window, so we can xcb_icccm_get_wm_hints*()
-    // from various setter functions for adjusting the hints.
+    // from various setter functions for adjusting the hints. It already has
+    // what setWindowState() and setWindowFlags() below would read back and
+    // change, so that they don't need a round-trip.
     xcb_icccm_wm_hints_t hints;
     memset(&hints, 0, sizeof(hints));
     hints.flags = XCB_ICCCM_WM_HINT_WINDOW_GROUP;
     hints.window_group = connection()->clientLeader();
+    xcb_icccm_wm_hints_set_input(&hints, !(window()->flags() & Qt::WindowDoesNotAcceptFocus));
+    if (window()->windowStates() & Qt::WindowMinimized)
+        xcb_icccm_wm_hints_set_iconic(&hints);
+    else if (window()->windowStates() != Qt::WindowNoState)
+        xcb_icccm_wm_hints_set_normal(&hints);
     xcb_icccm_set_wm_hints(xcb_connection(), m_window, &hints);
 
     xcb_window_t leader = connection()->clientLeader();
@@ -475,13 +500,17 @@ void QXcbWindow::create()
         connection()->xi2SelectDeviceEvents(m_window);
     }
 
+    m_creating = true;
     setWindowState(window()->windowStates());
     setWindowFlags(window()->flags());
+    m_creating = false;
     setWindowTitle(window()->title());
 
 #if QT_CONFIG(xcb_xlib)
-    // force sync to read outstanding requests - see QTBUG-29106
-    XSync(static_cast<Display*>(platformScreen->connection()->xlib_display()), false);
+    // let Xlib catch up with the requests sent behind its back - see QTBUG-29106
+    connection()->keepXlibInSync(createCookie.sequence);
+#else
+    Q_UNUSED(createCookie);
 #endif
 
     const qreal opacity = qt_window_private(window())->opacity;
@@ -515,6 +544,9 @@ QXcbForeignWindow::~QXcbForeignWindow()
 
 void QXcbWindow::destroy()
 {
+    // Don't let a flush still being sent draw to a window which is gone
+    connection()->waitForFlushes();
+
     if (connection()->focusWindow() == this)
         doFocusOut();
     if (connection()->mouseGrabber() == this)
@@ -522,6 +554,14 @@ void QXcbWindow::destroy()
 
     if (m_syncCounter && connection()->hasXSync())
         xcb_sync_destroy_counter(xcb_connection(), m_syncCounter);
+    if (m_extendedSyncCounter) {
+        xcb_sync_destroy_counter(xcb_connection(), m_extendedSyncCounter);
+        m_extendedSyncCounter = 0;
+        reportFrameTimings(true);
+    }
+    // The window may have moved to another screen since requesting an update
+    for (QXcbScreen *screen : connection()->screens())
+        screen->frameClock()->cancelUpdate(this);
     if (m_window) {
         if (m_netWmUserTimeWindow) {
             xcb_delete_property(xcb_connection(), m_window, atom(QXcbAtom::_NET_WM_USER_TIME_WINDOW));
@@ -535,9 +575,8 @@ void QXcbWindow::destroy()
         xcb_destroy_window(xcb_connection(), m_window);
         m_window = 0;
     }
-    if (m_cmap) {
-        xcb_free_colormap(xcb_connection(), m_cmap);
-    }
+    // The colormap is shared with the other windows of the visual
+    m_cmap = 0;
     m_mapped = false;
 
     if (m_pendingSyncRequest)
@@ -798,6 +837,8 @@ void QXcbWindow::doFocusIn()
 void QXcbWindow::doFocusOut()
 {
     connection()->setFocusWindow(nullptr);
+    // The release of a held key may be delivered to whoever gets the focus next.
+    connection()->keyboard()->resetAutoRepeat();
     relayFocusToModalWindow();
     // Do not set the active window to nullptr if there is a FocusIn coming.
     connection()->focusInTimer().start();
@@ -1119,17 +1160,20 @@ void QXcbWindow::setWindowState(Qt::WindowStates state)
 
     setNetWmState(state);
 
-    xcb_get_property_cookie_t cookie = xcb_icccm_get_wm_hints_unchecked(xcb_connection(), m_window);
-    xcb_icccm_wm_hints_t hints;
-    if (xcb_icccm_get_wm_hints_reply(xcb_connection(), cookie, &hints, nullptr)) {
-        if (state & Qt::WindowMinimized)
-            xcb_icccm_wm_hints_set_iconic(&hints);
-        else
-            xcb_icccm_wm_hints_set_normal(&hints);
-        xcb_icccm_set_wm_hints(xcb_connection(), m_window, &hints);
-    }
+    // A window being created has nothing to wait for
+    if (!m_creating) {
+        xcb_get_property_cookie_t cookie = xcb_icccm_get_wm_hints_unchecked(xcb_connection(), m_window);
+        xcb_icccm_wm_hints_t hints;
+        if (xcb_icccm_get_wm_hints_reply(xcb_connection(), cookie, &hints, nullptr)) {
+            if (state & Qt::WindowMinimized)
+                xcb_icccm_wm_hints_set_iconic(&hints);
+            else
+                xcb_icccm_wm_hints_set_normal(&hints);
+            xcb_icccm_set_wm_hints(xcb_connection(), m_window, &hints);
+        }
 
-    connection()->sync();
+        connection()->sync();
+    }
     m_windowState = state;
 }
 
@@ -1180,6 +1224,9 @@ void QXcbWindow::updateNetWmUserTime(xcb_timestamp_t timestamp)
 
 void QXcbWindow::updateDoesNotAcceptFocus(bool doesNotAcceptFocus)
 {
+    if (m_creating)
+        return;
+
     xcb_get_property_cookie_t cookie = xcb_icccm_get_wm_hints_unchecked(xcb_connection(), m_window);
 
     xcb_icccm_wm_hints_t hints;
@@ -1323,6 +1370,16 @@ void QXcbWindow::requestActivateWindow()
     connection()->sync();
 }
 
+void QXcbWindow::requestUpdate()
+{
+    // Deliver the update together with the other windows on the screen,
+    // in step with its refresh rate
+    if (QXcbScreen *screen = xcbScreen())
+        screen->frameClock()->requestUpdate(this);
+    else
+        QPlatformWindow::requestUpdate();
+}
+
 QSurfaceFormat QXcbWindow::format() const
 {
     return m_format;
@@ -1582,6 +1639,8 @@ void QXcbWindow::handleClientMessageEvent(const xcb_client_message_event_t *even
             connection()->setTime(event->data.data32[1]);
             m_syncValue.lo = event->data.data32[2];
             m_syncValue.hi = event->data.data32[3];
+            // The value is meant for the extended counter if the fifth field is set
+            m_syncRequestIsExtended = m_extendedSyncCounter && event->data.data32[4] != 0;
             if (connection()->hasXSync())
                 m_syncState = SyncReceived;
 #ifndef QT_NO_WHATSTHIS
@@ -1592,6 +1651,10 @@ void QXcbWindow::handleClientMessageEvent(const xcb_client_message_event_t *even
             qCWarning(lcQpaXcb, "Unhandled WM_PROTOCOLS (%s)",
                       connection()->atomName(protocolAtom).constData());
         }
+    } else if (event->type == atom(QXcbAtom::_NET_WM_FRAME_DRAWN)) {
+        handleFrameDrawn(event);
+    } else if (event->type == atom(QXcbAtom::_NET_WM_FRAME_TIMINGS)) {
+        handleFrameTimings(event);
     } else if (event->type == atom(QXcbAtom::_XEMBED)) {
         handleXEmbedMessage(event);
     } else if (event->type == atom(QXcbAtom::_NET_ACTIVE_WINDOW)) {
@@ -1652,7 +1715,7 @@ void QXcbWindow::handleConfigureNotifyEvent(const xcb_configure_notify_event_t *
 
 bool QXcbWindow::isExposed() const
 {
-    return m_mapped;
+    return m_mapped && !m_obscured && !m_hidden;
 }
 
 bool QXcbWindow::isEmbedded() const
@@ -1709,10 +1772,45 @@ void QXcbWindow::handleUnmapNotifyEvent(const xcb_unmap_notify_event_t *event)
 {
     if (event->window == m_window) {
         m_mapped = false;
+        // Both are reported again once the window gets mapped
+        m_obscured = false;
+        m_hidden = false;
         QWindowSystemInterface::handleExposeEvent(window(), QRegion());
     }
 }
 
+void QXcbWindow::handleVisibilityNotifyEvent(const xcb_visibility_notify_event_t *event)
+{
+    setVisibility(event->state == XCB_VISIBILITY_FULLY_OBSCURED, m_hidden);
+}
+
+/*!
+    Updates whether the window is covered by other windows or hidden by the
+    window manager. Windows which can't be seen are reported as not exposed,
+    so that they don't keep painting and flushing for nothing.
+*/
+void QXcbWindow::setVisibility(bool obscured, bool hidden)
+{
+    const bool wasExposed = isExposed();
+    m_obscured = obscured;
+    m_hidden = hidden;
+    if (!m_mapped || isExposed() == wasExposed)
+        return;
+
+    qCDebug(lcQpaXcb) << window() << (wasExposed ? "became invisible" : "became visible again")
+                      << "obscured:" << m_obscured << "hidden:" << m_hidden;
+    if (isExposed()) {
+        // Nothing was flushed while the window couldn't be seen
+        QWindowSystemInterface::handleExposeEvent(window(), QRect(QPoint(), geometry().size()));
+    } else {
+        QWindowSystemInterface::handleExposeEvent(window(), QRegion());
+    }
+
+    // A pending update may be due sooner, or later, now
+    if (QXcbScreen *screen = xcbScreen())
+        screen->frameClock()->scheduleTick();
+}
+
 void QXcbWindow::handleEnterNotifyEvent(int event_x, int event_y, int root_x, int root_y, xcb_timestamp_t timestamp)
 {
     connection()->setTime(timestamp);
@@ -1820,6 +1918,11 @@ void QXcbWindow::handlePropertyNotifyEvent(const xcb_property_notify_event_t *ev
                             || states.testFlag(NetWmStateHidden)))
             newState = Qt::WindowMinimized;
 
+        // This also covers windows on other desktops, which compositing
+        // window managers keep mapped
+        if (event->atom == atom(QXcbAtom::_NET_WM_STATE))
+            setVisibility(m_obscured, states.testFlag(NetWmStateHidden));
+
         if (states & NetWmStateFullScreen)
             newState |= Qt::WindowFullScreen;
         if ((states & NetWmStateMaximizedHorz) && (states & NetWmStateMaximizedVert))
@@ -1859,12 +1962,36 @@ void QXcbWindow::handleFocusOutEvent(const xcb_focus_out_event_t *event)
     doFocusOut();
 }
 
+static inline quint64 syncRequestValue(const xcb_sync_int64_t &value)
+{
+    return (quint64(quint32(value.hi)) << 32) | value.lo;
+}
+
+static inline qint64 monotonicTimeUs()
+{
+    // CLOCK_MONOTONIC, like the timestamps of the compositor
+    return QDeadlineTimer::current(Qt::PreciseTimer).deadlineNSecs() / 1000;
+}
+
 void QXcbWindow::updateSyncRequestCounter()
 {
     if (m_syncState != SyncAndConfigureReceived) {
         // window manager does not expect a sync event yet.
         return;
     }
+    if (m_syncRequestIsExtended) {
+        // Normally the frame drawn since the request has answered it already
+        const quint64 requested = syncRequestValue(m_syncValue);
+        if (m_extendedSyncValue < requested)
+            setExtendedSyncCounter(requested + requested % 2);
+        xcb_flush(xcb_connection());
+
+        m_syncValue.lo = 0;
+        m_syncValue.hi = 0;
+        m_syncRequestIsExtended = false;
+        m_syncState = NoSyncNeeded;
+        return;
+    }
     if (connection()->hasXSync() && (m_syncValue.lo != 0 || m_syncValue.hi != 0)) {
         xcb_sync_set_counter(xcb_connection(), m_syncCounter, m_syncValue);
         xcb_flush(xcb_connection());
@@ -1875,6 +2002,126 @@ void QXcbWindow::updateSyncRequestCounter()
     }
 }
 
+void QXcbWindow::setExtendedSyncCounter(quint64 value)
+{
+    m_extendedSyncValue = value;
+
+    xcb_sync_int64_t syncValue;
+    syncValue.hi = qint32(value >> 32);
+    syncValue.lo = quint32(value);
+    xcb_sync_set_counter(xcb_connection(), m_extendedSyncCounter, syncValue);
+}
+
+/*!
+    Tells the compositor that drawing a new frame into the window starts,
+    as part of the extended _NET_WM_SYNC_REQUEST protocol. The frame answers
+    a pending sync request.
+*/
+void QXcbWindow::beginFrame()
+{
+    if (!m_extendedSyncCounter)
+        return;
+
+    quint64 value = m_extendedSyncValue;
+    if (needsSync() && m_syncRequestIsExtended) {
+        const quint64 requested = syncRequestValue(m_syncValue);
+        value = qMax(value, requested + requested % 2);
+    }
+    if (value % 2 == 0)
+        setExtendedSyncCounter(value + 1);
+}
+
+/*!
+    Tells the compositor that the frame started with beginFrame() is complete.
+    It answers with _NET_WM_FRAME_DRAWN once it has drawn the frame.
+*/
+void QXcbWindow::endFrame()
+{
+    if (!m_extendedSyncCounter || m_extendedSyncValue % 2 == 0)
+        return;
+
+    setExtendedSyncCounter(m_extendedSyncValue + 1);
+    m_frameDrawnPending = true;
+    m_frameDrawnTimer.start();
+
+    const int maxFrameRecords = 8;
+    if (m_frameRecords.size() == maxFrameRecords)
+        m_frameRecords.removeFirst();
+    m_frameRecords.append({ m_extendedSyncValue, monotonicTimeUs(), 0 });
+}
+
+/*!
+    Returns whether the compositor has yet to draw the last frame, in which
+    case drawing another one would only queue up behind it.
+*/
+bool QXcbWindow::isWaitingForFrameDrawn() const
+{
+    // Don't stall with compositors which don't send _NET_WM_FRAME_DRAWN, or
+    // which stop sending it, e.g. when the window gets hidden
+    return m_frameDrawnPending && m_frameDrawnSeen && !m_frameDrawnTimer.hasExpired(100);
+}
+
+void QXcbWindow::handleFrameDrawn(const xcb_client_message_event_t *event)
+{
+    const quint64 counter = quint64(event->data.data32[0]) | (quint64(event->data.data32[1]) << 32);
+    const qint64 drawnTimeUs = qint64(quint64(event->data.data32[2]) | (quint64(event->data.data32[3]) << 32));
+
+    m_frameDrawnSeen = true;
+    if (counter >= m_extendedSyncValue)
+        m_frameDrawnPending = false;
+
+    for (FrameRecord &record : m_frameRecords) {
+        if (record.counter == counter)
+            record.drawnTimeUs = drawnTimeUs;
+    }
+
+    if (QXcbScreen *screen = xcbScreen())
+        screen->frameClock()->frameShown(drawnTimeUs * 1000);
+}
+
+void QXcbWindow::handleFrameTimings(const xcb_client_message_event_t *event)
+{
+    const quint64 counter = quint64(event->data.data32[0]) | (quint64(event->data.data32[1]) << 32);
+    // Relative to the time the frame was drawn, 0 if not known
+    const qint32 presentationOffsetUs = qint32(event->data.data32[2]);
+    const quint32 refreshIntervalUs = event->data.data32[3];
+    const quint32 frameDelayUs = event->data.data32[4];
+
+    const auto it = std::find_if(m_frameRecords.begin(), m_frameRecords.end(),
+                                 [counter](const FrameRecord &record) { return record.counter == counter; });
+    if (it == m_frameRecords.end())
+        return;
+
+    if (it->drawnTimeUs != 0 && presentationOffsetUs != 0) {
+        const qint64 latencyUs = it->drawnTimeUs + presentationOffsetUs - it->endTimeUs;
+        m_frameLatencyTotalUs += latencyUs;
+        m_frameLatencyMaxUs = qMax(m_frameLatencyMaxUs, latencyUs);
+        ++m_frameTimingCount;
+        qCDebug(lcQpaFrameTiming) << window() << "frame" << counter << "on screen" << latencyUs
+                                  << "us after it was complete, refresh interval" << refreshIntervalUs
+                                  << "us, delayed by" << frameDelayUs << "us";
+    }
+    m_frameRecords.erase(m_frameRecords.begin(), it + 1);
+
+    reportFrameTimings(false);
+}
+
+void QXcbWindow::reportFrameTimings(bool force)
+{
+    if (m_frameTimingCount == 0)
+        return;
+    if (!force && m_frameTimingReportTimer.isValid() && !m_frameTimingReportTimer.hasExpired(5000))
+        return;
+
+    qCDebug(lcQpaFrameTiming) << window() << m_frameTimingCount << "frames, latency average"
+                              << m_frameLatencyTotalUs / m_frameTimingCount << "us, maximum"
+                              << m_frameLatencyMaxUs << "us";
+    m_frameLatencyTotalUs = 0;
+    m_frameLatencyMaxUs = 0;
+    m_frameTimingCount = 0;
+    m_frameTimingReportTimer.start();
+}
+
 const xcb_visualtype_t *QXcbWindow::createVisual()
 {
     return xcbScreen() ? xcbScreen()->visualForFormat(m_format)
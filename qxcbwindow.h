@@ -43,6 +43,8 @@
 #include <qpa/qplatformwindow.h>
 #include <QtGui/QSurfaceFormat>
 #include <QtGui/QImage>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QVector>
 
 #include <xcb/xcb.h>
 #include <xcb/sync.h>
@@ -97,6 +99,7 @@ public:
     void propagateSizeHints() override;
 
     void requestActivateWindow() override;
+    void requestUpdate() override;
 
     bool setKeyboardGrabEnabled(bool grab) override;
     bool setMouseGrabEnabled(bool grab) override;
@@ -123,6 +126,7 @@ public:
     void handleConfigureNotifyEvent(const xcb_configure_notify_event_t *event) override;
     void handleMapNotifyEvent(const xcb_map_notify_event_t *event) override;
     void handleUnmapNotifyEvent(const xcb_unmap_notify_event_t *event) override;
+    void handleVisibilityNotifyEvent(const xcb_visibility_notify_event_t *event) override;
     void handleFocusInEvent(const xcb_focus_in_event_t *event) override;
     void handleFocusOutEvent(const xcb_focus_out_event_t *event) override;
     void handlePropertyNotifyEvent(const xcb_property_notify_event_t *event) override;
@@ -145,6 +149,10 @@ public:
 
     bool needsSync() const;
 
+    void beginFrame();
+    void endFrame();
+    bool isWaitingForFrameDrawn() const;
+
     void postSyncWindowRequest();
     void clearSyncWindowRequest() { m_pendingSyncRequest = nullptr; }
 
@@ -195,6 +203,13 @@ protected:
 
     void handleLeaveNotifyEvent(int root_x, int root_y, xcb_timestamp_t timestamp);
 
+    void setVisibility(bool obscured, bool hidden);
+
+    void setExtendedSyncCounter(quint64 value);
+    void handleFrameDrawn(const xcb_client_message_event_t *event);
+    void handleFrameTimings(const xcb_client_message_event_t *event);
+    void reportFrameTimings(bool force);
+
     xcb_window_t m_window = 0;
     xcb_colormap_t m_cmap = 0;
 
@@ -205,14 +220,40 @@ protected:
     xcb_sync_int64_t m_syncValue;
     xcb_sync_counter_t m_syncCounter = 0;
 
+    // The extended counter of the _NET_WM_SYNC_REQUEST protocol, which is odd
+    // while a frame is being drawn and even once it is complete
+    xcb_sync_counter_t m_extendedSyncCounter = 0;
+    quint64 m_extendedSyncValue = 0;
+    bool m_syncRequestIsExtended = false;
+    bool m_frameDrawnPending = false;
+    bool m_frameDrawnSeen = false;
+    QElapsedTimer m_frameDrawnTimer;
+
+    // Completed frames, for matching up the compositor's frame timings
+    struct FrameRecord {
+        quint64 counter;
+        qint64 endTimeUs;
+        qint64 drawnTimeUs;
+    };
+    QVector<FrameRecord> m_frameRecords;
+    qint64 m_frameLatencyTotalUs = 0;
+    qint64 m_frameLatencyMaxUs = 0;
+    int m_frameTimingCount = 0;
+    QElapsedTimer m_frameTimingReportTimer;
+
     Qt::WindowStates m_windowState = Qt::WindowNoState;
 
     bool m_mapped = false;
+    // Whether the mapped window can't be seen, because other windows cover it,
+    // or because the window manager hides it (_NET_WM_STATE_HIDDEN)
+    bool m_obscured = false;
+    bool m_hidden = false;
     bool m_transparent = false;
     bool m_deferredActivation = false;
     bool m_embedded = false;
     bool m_alertState = false;
     bool m_minimized = false;
+    bool m_creating = false; // create() sets WM_HINTS in full, nothing to read back
     xcb_window_t m_netWmUserTimeWindow = XCB_NONE;
 
     QSurfaceFormat m_format;
@@ -20,7 +20,7 @@ extern "C" {
 #endif
 
 #define XCB_SHM_MAJOR_VERSION 1
-#define XCB_SHM_MINOR_VERSION 1
+#define XCB_SHM_MINOR_VERSION 2
   
 extern xcb_extension_t xcb_shm_id;
 
@@ -726,6 +726,78 @@ xcb_shm_create_pixmap (xcb_connection_t *c  /**< */,
                        xcb_shm_seg_t     shmseg  /**< */,
                        uint32_t          offset  /**< */);
 
+/** Opcode for xcb_shm_attach_fd. */
+#define XCB_SHM_ATTACH_FD 6
+
+/**
+ * @brief xcb_shm_attach_fd_request_t
+ **/
+typedef struct xcb_shm_attach_fd_request_t {
+    uint8_t       major_opcode; /**<  */
+    uint8_t       minor_opcode; /**<  */
+    uint16_t      length; /**<  */
+    xcb_shm_seg_t shmseg; /**<  */
+    uint8_t       read_only; /**<  */
+    uint8_t       pad0[3]; /**<  */
+} xcb_shm_attach_fd_request_t;
+
+/**
+ *
+ * @param c The connection
+ * @return A cookie
+ *
+ * Delivers a request to the X server.
+ * 
+ * This form can be used only if the request will not cause
+ * a reply to be generated. Any returned error will be
+ * saved for handling by xcb_request_check().
+ */
+
+/*****************************************************************************
+ **
+ ** xcb_void_cookie_t xcb_shm_attach_fd_checked
+ ** 
+ ** @param xcb_connection_t *c
+ ** @param xcb_shm_seg_t     shmseg
+ ** @param int32_t           shm_fd
+ ** @param uint8_t           read_only
+ ** @returns xcb_void_cookie_t
+ **
+ *****************************************************************************/
+ 
+xcb_void_cookie_t
+xcb_shm_attach_fd_checked (xcb_connection_t *c  /**< */,
+                           xcb_shm_seg_t     shmseg  /**< */,
+                           int32_t           shm_fd  /**< */,
+                           uint8_t           read_only  /**< */);
+
+/**
+ *
+ * @param c The connection
+ * @return A cookie
+ *
+ * Delivers a request to the X server.
+ * 
+ */
+
+/*****************************************************************************
+ **
+ ** xcb_void_cookie_t xcb_shm_attach_fd
+ ** 
+ ** @param xcb_connection_t *c
+ ** @param xcb_shm_seg_t     shmseg
+ ** @param int32_t           shm_fd
+ ** @param uint8_t           read_only
+ ** @returns xcb_void_cookie_t
+ **
+ *****************************************************************************/
+ 
+xcb_void_cookie_t
+xcb_shm_attach_fd (xcb_connection_t *c  /**< */,
+                   xcb_shm_seg_t     shmseg  /**< */,
+                   int32_t           shm_fd  /**< */,
+                   uint8_t           read_only  /**< */);
+
 
 #ifdef __cplusplus
 }
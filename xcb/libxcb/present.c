@@ -0,0 +1,478 @@
+/*
+ * This file generated automatically from present.xml by c_client.py.
+ * Edit at your peril.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stddef.h>  /* for offsetof() */
+#include "xcbext.h"
+#include "present.h"
+
+#define ALIGNOF(type) offsetof(struct { char dummy; type member; }, member)
+#include "xproto.h"
+
+xcb_extension_t xcb_present_id = { "Present", 0 };
+
+
+/*****************************************************************************
+ **
+ ** xcb_present_query_version_cookie_t xcb_present_query_version
+ ** 
+ ** @param xcb_connection_t *c
+ ** @param uint32_t major_version
+ ** @param uint32_t minor_version
+ ** @returns xcb_present_query_version_cookie_t
+ **
+ *****************************************************************************/
+ 
+xcb_present_query_version_cookie_t
+xcb_present_query_version (xcb_connection_t *c  /**< */,
+                           uint32_t          major_version  /**< */,
+                           uint32_t          minor_version  /**< */)
+{
+    static const xcb_protocol_request_t xcb_req = {
+        /* count */ 2,
+        /* ext */ &xcb_present_id,
+        /* opcode */ XCB_PRESENT_QUERY_VERSION,
+        /* isvoid */ 0
+    };
+    
+    struct iovec xcb_parts[4];
+    xcb_present_query_version_cookie_t xcb_ret;
+    xcb_present_query_version_request_t xcb_out;
+    
+    xcb_out.major_version = major_version;
+    xcb_out.minor_version = minor_version;
+    
+    xcb_parts[2].iov_base = (char *) &xcb_out;
+    xcb_parts[2].iov_len = sizeof(xcb_out);
+    xcb_parts[3].iov_base = 0;
+    xcb_parts[3].iov_len = -xcb_parts[2].iov_len & 3;
+    
+    xcb_ret.sequence = xcb_send_request(c, XCB_REQUEST_CHECKED, xcb_parts + 2, &xcb_req);
+    return xcb_ret;
+}
+
+
+/*****************************************************************************
+ **
+ ** xcb_present_query_version_cookie_t xcb_present_query_version_unchecked
+ ** 
+ ** @param xcb_connection_t *c
+ ** @param uint32_t major_version
+ ** @param uint32_t minor_version
+ ** @returns xcb_present_query_version_cookie_t
+ **
+ *****************************************************************************/
+ 
+xcb_present_query_version_cookie_t
+xcb_present_query_version_unchecked (xcb_connection_t *c  /**< */,
+                                     uint32_t          major_version  /**< */,
+                                     uint32_t          minor_version  /**< */)
+{
+    static const xcb_protocol_request_t xcb_req = {
+        /* count */ 2,
+        /* ext */ &xcb_present_id,
+        /* opcode */ XCB_PRESENT_QUERY_VERSION,
+        /* isvoid */ 0
+    };
+    
+    struct iovec xcb_parts[4];
+    xcb_present_query_version_cookie_t xcb_ret;
+    xcb_present_query_version_request_t xcb_out;
+    
+    xcb_out.major_version = major_version;
+    xcb_out.minor_version = minor_version;
+    
+    xcb_parts[2].iov_base = (char *) &xcb_out;
+    xcb_parts[2].iov_len = sizeof(xcb_out);
+    xcb_parts[3].iov_base = 0;
+    xcb_parts[3].iov_len = -xcb_parts[2].iov_len & 3;
+    
+    xcb_ret.sequence = xcb_send_request(c, 0, xcb_parts + 2, &xcb_req);
+    return xcb_ret;
+}
+
+
+/*****************************************************************************
+ **
+ ** xcb_present_query_version_reply_t * xcb_present_query_version_reply
+ ** 
+ ** @param xcb_connection_t *c
+ ** @param xcb_present_query_version_cookie_t cookie
+ ** @param xcb_generic_error_t **e
+ ** @returns xcb_present_query_version_reply_t *
+ **
+ *****************************************************************************/
+ 
+xcb_present_query_version_reply_t *
+xcb_present_query_version_reply (xcb_connection_t                    *c  /**< */,
+                                 xcb_present_query_version_cookie_t    cookie  /**< */,
+                                 xcb_generic_error_t                **e  /**< */)
+{
+    return (xcb_present_query_version_reply_t *) xcb_wait_for_reply(c, cookie.sequence, e);
+}
+
+
+/*****************************************************************************
+ **
+ ** xcb_void_cookie_t xcb_present_pixmap_checked
+ ** 
+ ** @param xcb_connection_t *c
+ ** @param xcb_window_t window
+ ** @param xcb_pixmap_t pixmap
+ ** @param uint32_t serial
+ ** @param uint32_t valid
+ ** @param uint32_t update
+ ** @param int16_t x_off
+ ** @param int16_t y_off
+ ** @param uint32_t target_crtc
+ ** @param uint32_t wait_fence
+ ** @param uint32_t idle_fence
+ ** @param uint32_t options
+ ** @param uint64_t target_msc
+ ** @param uint64_t divisor
+ ** @param uint64_t remainder
+ ** @param uint32_t notifies_len
+ ** @param const xcb_present_notify_t *notifies
+ ** @returns xcb_void_cookie_t
+ **
+ *****************************************************************************/
+ 
+xcb_void_cookie_t
+xcb_present_pixmap_checked (xcb_connection_t           *c  /**< */,
+                            xcb_window_t                window  /**< */,
+                            xcb_pixmap_t                pixmap  /**< */,
+                            uint32_t                    serial  /**< */,
+                            uint32_t                    valid  /**< */,
+                            uint32_t                    update  /**< */,
+                            int16_t                     x_off  /**< */,
+                            int16_t                     y_off  /**< */,
+                            uint32_t                    target_crtc  /**< */,
+                            uint32_t                    wait_fence  /**< */,
+                            uint32_t                    idle_fence  /**< */,
+                            uint32_t                    options  /**< */,
+                            uint64_t                    target_msc  /**< */,
+                            uint64_t                    divisor  /**< */,
+                            uint64_t                    remainder  /**< */,
+                            uint32_t                    notifies_len  /**< */,
+                            const xcb_present_notify_t *notifies  /**< */)
+{
+    static const xcb_protocol_request_t xcb_req = {
+        /* count */ 4,
+        /* ext */ &xcb_present_id,
+        /* opcode */ XCB_PRESENT_PIXMAP,
+        /* isvoid */ 1
+    };
+    
+    struct iovec xcb_parts[6];
+    xcb_void_cookie_t xcb_ret;
+    xcb_present_pixmap_request_t xcb_out;
+    
+    xcb_out.window = window;
+    xcb_out.pixmap = pixmap;
+    xcb_out.serial = serial;
+    xcb_out.valid = valid;
+    xcb_out.update = update;
+    xcb_out.x_off = x_off;
+    xcb_out.y_off = y_off;
+    xcb_out.target_crtc = target_crtc;
+    xcb_out.wait_fence = wait_fence;
+    xcb_out.idle_fence = idle_fence;
+    xcb_out.options = options;
+    memset(xcb_out.pad0, 0, 4);
+    xcb_out.target_msc = target_msc;
+    xcb_out.divisor = divisor;
+    xcb_out.remainder = remainder;
+    
+    xcb_parts[2].iov_base = (char *) &xcb_out;
+    xcb_parts[2].iov_len = sizeof(xcb_out);
+    xcb_parts[3].iov_base = 0;
+    xcb_parts[3].iov_len = -xcb_parts[2].iov_len & 3;
+    /* xcb_present_notify_t notifies */
+    xcb_parts[4].iov_base = (char *) notifies;
+    xcb_parts[4].iov_len = notifies_len * sizeof(xcb_present_notify_t);
+    xcb_parts[5].iov_base = 0;
+    xcb_parts[5].iov_len = -xcb_parts[4].iov_len & 3;
+    
+    xcb_ret.sequence = xcb_send_request(c, XCB_REQUEST_CHECKED, xcb_parts + 2, &xcb_req);
+    return xcb_ret;
+}
+
+
+/*****************************************************************************
+ **
+ ** xcb_void_cookie_t xcb_present_pixmap
+ ** 
+ ** @param xcb_connection_t *c
+ ** @param xcb_window_t window
+ ** @param xcb_pixmap_t pixmap
+ ** @param uint32_t serial
+ ** @param uint32_t valid
+ ** @param uint32_t update
+ ** @param int16_t x_off
+ ** @param int16_t y_off
+ ** @param uint32_t target_crtc
+ ** @param uint32_t wait_fence
+ ** @param uint32_t idle_fence
+ ** @param uint32_t options
+ ** @param uint64_t target_msc
+ ** @param uint64_t divisor
+ ** @param uint64_t remainder
+ ** @param uint32_t notifies_len
+ ** @param const xcb_present_notify_t *notifies
+ ** @returns xcb_void_cookie_t
+ **
+ *****************************************************************************/
+ 
+xcb_void_cookie_t
+xcb_present_pixmap (xcb_connection_t           *c  /**< */,
+                    xcb_window_t                window  /**< */,
+                    xcb_pixmap_t                pixmap  /**< */,
+                    uint32_t                    serial  /**< */,
+                    uint32_t                    valid  /**< */,
+                    uint32_t                    update  /**< */,
+                    int16_t                     x_off  /**< */,
+                    int16_t                     y_off  /**< */,
+                    uint32_t                    target_crtc  /**< */,
+                    uint32_t                    wait_fence  /**< */,
+                    uint32_t                    idle_fence  /**< */,
+                    uint32_t                    options  /**< */,
+                    uint64_t                    target_msc  /**< */,
+                    uint64_t                    divisor  /**< */,
+                    uint64_t                    remainder  /**< */,
+                    uint32_t                    notifies_len  /**< */,
+                    const xcb_present_notify_t *notifies  /**< */)
+{
+    static const xcb_protocol_request_t xcb_req = {
+        /* count */ 4,
+        /* ext */ &xcb_present_id,
+        /* opcode */ XCB_PRESENT_PIXMAP,
+        /* isvoid */ 1
+    };
+    
+    struct iovec xcb_parts[6];
+    xcb_void_cookie_t xcb_ret;
+    xcb_present_pixmap_request_t xcb_out;
+    
+    xcb_out.window = window;
+    xcb_out.pixmap = pixmap;
+    xcb_out.serial = serial;
+    xcb_out.valid = valid;
+    xcb_out.update = update;
+    xcb_out.x_off = x_off;
+    xcb_out.y_off = y_off;
+    xcb_out.target_crtc = target_crtc;
+    xcb_out.wait_fence = wait_fence;
+    xcb_out.idle_fence = idle_fence;
+    xcb_out.options = options;
+    memset(xcb_out.pad0, 0, 4);
+    xcb_out.target_msc = target_msc;
+    xcb_out.divisor = divisor;
+    xcb_out.remainder = remainder;
+    
+    xcb_parts[2].iov_base = (char *) &xcb_out;
+    xcb_parts[2].iov_len = sizeof(xcb_out);
+    xcb_parts[3].iov_base = 0;
+    xcb_parts[3].iov_len = -xcb_parts[2].iov_len & 3;
+    /* xcb_present_notify_t notifies */
+    xcb_parts[4].iov_base = (char *) notifies;
+    xcb_parts[4].iov_len = notifies_len * sizeof(xcb_present_notify_t);
+    xcb_parts[5].iov_base = 0;
+    xcb_parts[5].iov_len = -xcb_parts[4].iov_len & 3;
+    
+    xcb_ret.sequence = xcb_send_request(c, 0, xcb_parts + 2, &xcb_req);
+    return xcb_ret;
+}
+
+
+/*****************************************************************************
+ **
+ ** xcb_void_cookie_t xcb_present_notify_msc_checked
+ ** 
+ ** @param xcb_connection_t *c
+ ** @param xcb_window_t window
+ ** @param uint32_t serial
+ ** @param uint64_t target_msc
+ ** @param uint64_t divisor
+ ** @param uint64_t remainder
+ ** @returns xcb_void_cookie_t
+ **
+ *****************************************************************************/
+ 
+xcb_void_cookie_t
+xcb_present_notify_msc_checked (xcb_connection_t *c  /**< */,
+                                xcb_window_t      window  /**< */,
+                                uint32_t          serial  /**< */,
+                                uint64_t          target_msc  /**< */,
+                                uint64_t          divisor  /**< */,
+                                uint64_t          remainder  /**< */)
+{
+    static const xcb_protocol_request_t xcb_req = {
+        /* count */ 2,
+        /* ext */ &xcb_present_id,
+        /* opcode */ XCB_PRESENT_NOTIFY_MSC,
+        /* isvoid */ 1
+    };
+    
+    struct iovec xcb_parts[4];
+    xcb_void_cookie_t xcb_ret;
+    xcb_present_notify_msc_request_t xcb_out;
+    
+    xcb_out.window = window;
+    xcb_out.serial = serial;
+    memset(xcb_out.pad0, 0, 4);
+    xcb_out.target_msc = target_msc;
+    xcb_out.divisor = divisor;
+    xcb_out.remainder = remainder;
+    
+    xcb_parts[2].iov_base = (char *) &xcb_out;
+    xcb_parts[2].iov_len = sizeof(xcb_out);
+    xcb_parts[3].iov_base = 0;
+    xcb_parts[3].iov_len = -xcb_parts[2].iov_len & 3;
+    
+    xcb_ret.sequence = xcb_send_request(c, XCB_REQUEST_CHECKED, xcb_parts + 2, &xcb_req);
+    return xcb_ret;
+}
+
+
+/*****************************************************************************
+ **
+ ** xcb_void_cookie_t xcb_present_notify_msc
+ ** 
+ ** @param xcb_connection_t *c
+ ** @param xcb_window_t window
+ ** @param uint32_t serial
+ ** @param uint64_t target_msc
+ ** @param uint64_t divisor
+ ** @param uint64_t remainder
+ ** @returns xcb_void_cookie_t
+ **
+ *****************************************************************************/
+ 
+xcb_void_cookie_t
+xcb_present_notify_msc (xcb_connection_t *c  /**< */,
+                        xcb_window_t      window  /**< */,
+                        uint32_t          serial  /**< */,
+                        uint64_t          target_msc  /**< */,
+                        uint64_t          divisor  /**< */,
+                        uint64_t          remainder  /**< */)
+{
+    static const xcb_protocol_request_t xcb_req = {
+        /* count */ 2,
+        /* ext */ &xcb_present_id,
+        /* opcode */ XCB_PRESENT_NOTIFY_MSC,
+        /* isvoid */ 1
+    };
+    
+    struct iovec xcb_parts[4];
+    xcb_void_cookie_t xcb_ret;
+    xcb_present_notify_msc_request_t xcb_out;
+    
+    xcb_out.window = window;
+    xcb_out.serial = serial;
+    memset(xcb_out.pad0, 0, 4);
+    xcb_out.target_msc = target_msc;
+    xcb_out.divisor = divisor;
+    xcb_out.remainder = remainder;
+    
+    xcb_parts[2].iov_base = (char *) &xcb_out;
+    xcb_parts[2].iov_len = sizeof(xcb_out);
+    xcb_parts[3].iov_base = 0;
+    xcb_parts[3].iov_len = -xcb_parts[2].iov_len & 3;
+    
+    xcb_ret.sequence = xcb_send_request(c, 0, xcb_parts + 2, &xcb_req);
+    return xcb_ret;
+}
+
+
+/*****************************************************************************
+ **
+ ** xcb_void_cookie_t xcb_present_select_input_checked
+ ** 
+ ** @param xcb_connection_t *c
+ ** @param xcb_present_event_t eid
+ ** @param xcb_window_t window
+ ** @param uint32_t event_mask
+ ** @returns xcb_void_cookie_t
+ **
+ *****************************************************************************/
+ 
+xcb_void_cookie_t
+xcb_present_select_input_checked (xcb_connection_t    *c  /**< */,
+                                  xcb_present_event_t  eid  /**< */,
+                                  xcb_window_t         window  /**< */,
+                                  uint32_t             event_mask  /**< */)
+{
+    static const xcb_protocol_request_t xcb_req = {
+        /* count */ 2,
+        /* ext */ &xcb_present_id,
+        /* opcode */ XCB_PRESENT_SELECT_INPUT,
+        /* isvoid */ 1
+    };
+    
+    struct iovec xcb_parts[4];
+    xcb_void_cookie_t xcb_ret;
+    xcb_present_select_input_request_t xcb_out;
+    
+    xcb_out.eid = eid;
+    xcb_out.window = window;
+    xcb_out.event_mask = event_mask;
+    
+    xcb_parts[2].iov_base = (char *) &xcb_out;
+    xcb_parts[2].iov_len = sizeof(xcb_out);
+    xcb_parts[3].iov_base = 0;
+    xcb_parts[3].iov_len = -xcb_parts[2].iov_len & 3;
+    
+    xcb_ret.sequence = xcb_send_request(c, XCB_REQUEST_CHECKED, xcb_parts + 2, &xcb_req);
+    return xcb_ret;
+}
+
+
+/*****************************************************************************
+ **
+ ** xcb_void_cookie_t xcb_present_select_input
+ ** 
+ ** @param xcb_connection_t *c
+ ** @param xcb_present_event_t eid
+ ** @param xcb_window_t window
+ ** @param uint32_t event_mask
+ ** @returns xcb_void_cookie_t
+ **
+ *****************************************************************************/
+ 
+xcb_void_cookie_t
+xcb_present_select_input (xcb_connection_t    *c  /**< */,
+                          xcb_present_event_t  eid  /**< */,
+                          xcb_window_t         window  /**< */,
+                          uint32_t             event_mask  /**< */)
+{
+    static const xcb_protocol_request_t xcb_req = {
+        /* count */ 2,
+        /* ext */ &xcb_present_id,
+        /* opcode */ XCB_PRESENT_SELECT_INPUT,
+        /* isvoid */ 1
+    };
+    
+    struct iovec xcb_parts[4];
+    xcb_void_cookie_t xcb_ret;
+    xcb_present_select_input_request_t xcb_out;
+    
+    xcb_out.eid = eid;
+    xcb_out.window = window;
+    xcb_out.event_mask = event_mask;
+    
+    xcb_parts[2].iov_base = (char *) &xcb_out;
+    xcb_parts[2].iov_len = sizeof(xcb_out);
+    xcb_parts[3].iov_base = 0;
+    xcb_parts[3].iov_len = -xcb_parts[2].iov_len & 3;
+    
+    xcb_ret.sequence = xcb_send_request(c, 0, xcb_parts + 2, &xcb_req);
+    return xcb_ret;
+}
+
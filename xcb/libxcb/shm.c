@@ -722,3 +722,91 @@ xcb_shm_create_pixmap (xcb_connection_t *c  /**< */,
     return xcb_ret;
 }
 
+
+
+/*****************************************************************************
+ **
+ ** xcb_void_cookie_t xcb_shm_attach_fd_checked
+ ** 
+ ** @param xcb_connection_t *c
+ ** @param xcb_shm_seg_t     shmseg
+ ** @param int32_t           shm_fd
+ ** @param uint8_t           read_only
+ ** @returns xcb_void_cookie_t
+ **
+ *****************************************************************************/
+ 
+xcb_void_cookie_t
+xcb_shm_attach_fd_checked (xcb_connection_t *c  /**< */,
+                           xcb_shm_seg_t     shmseg  /**< */,
+                           int32_t           shm_fd  /**< */,
+                           uint8_t           read_only  /**< */)
+{
+    static const xcb_protocol_request_t xcb_req = {
+        /* count */ 2,
+        /* ext */ &xcb_shm_id,
+        /* opcode */ XCB_SHM_ATTACH_FD,
+        /* isvoid */ 1
+    };
+    
+    struct iovec xcb_parts[4];
+    xcb_void_cookie_t xcb_ret;
+    xcb_shm_attach_fd_request_t xcb_out;
+    
+    xcb_out.shmseg = shmseg;
+    xcb_out.read_only = read_only;
+    memset(xcb_out.pad0, 0, 3);
+    
+    xcb_parts[2].iov_base = (char *) &xcb_out;
+    xcb_parts[2].iov_len = sizeof(xcb_out);
+    xcb_parts[3].iov_base = 0;
+    xcb_parts[3].iov_len = -xcb_parts[2].iov_len & 3;
+    
+    xcb_send_fd(c, shm_fd);
+    xcb_ret.sequence = xcb_send_request(c, XCB_REQUEST_CHECKED, xcb_parts + 2, &xcb_req);
+    return xcb_ret;
+}
+
+
+/*****************************************************************************
+ **
+ ** xcb_void_cookie_t xcb_shm_attach_fd
+ ** 
+ ** @param xcb_connection_t *c
+ ** @param xcb_shm_seg_t     shmseg
+ ** @param int32_t           shm_fd
+ ** @param uint8_t           read_only
+ ** @returns xcb_void_cookie_t
+ **
+ *****************************************************************************/
+ 
+xcb_void_cookie_t
+xcb_shm_attach_fd (xcb_connection_t *c  /**< */,
+                   xcb_shm_seg_t     shmseg  /**< */,
+                   int32_t           shm_fd  /**< */,
+                   uint8_t           read_only  /**< */)
+{
+    static const xcb_protocol_request_t xcb_req = {
+        /* count */ 2,
+        /* ext */ &xcb_shm_id,
+        /* opcode */ XCB_SHM_ATTACH_FD,
+        /* isvoid */ 1
+    };
+    
+    struct iovec xcb_parts[4];
+    xcb_void_cookie_t xcb_ret;
+    xcb_shm_attach_fd_request_t xcb_out;
+    
+    xcb_out.shmseg = shmseg;
+    xcb_out.read_only = read_only;
+    memset(xcb_out.pad0, 0, 3);
+    
+    xcb_parts[2].iov_base = (char *) &xcb_out;
+    xcb_parts[2].iov_len = sizeof(xcb_out);
+    xcb_parts[3].iov_base = 0;
+    xcb_parts[3].iov_len = -xcb_parts[2].iov_len & 3;
+    
+    xcb_send_fd(c, shm_fd);
+    xcb_ret.sequence = xcb_send_request(c, 0, xcb_parts + 2, &xcb_req);
+    return xcb_ret;
+}
@@ -2,7 +2,7 @@
 # Statically compile in code for
 # libxcb-fixes, libxcb-randr, libxcb-shm, libxcb-sync, libxcb-image,
 # libxcb-keysyms, libxcb-icccm, libxcb-renderutil, libxcb-xkb,
-# libxcb-xinerama, libxcb-xinput
+# libxcb-xinerama, libxcb-xinput, libxcb-present
 #
 TEMPLATE = lib
 TARGET = xcb-static
@@ -34,7 +34,8 @@ SOURCES += \
     $$LIBXCB_DIR/shape.c \
     $$LIBXCB_DIR/xkb.c \
     $$LIBXCB_DIR/xinerama.c \
-    $$LIBXCB_DIR/xinput.c
+    $$LIBXCB_DIR/xinput.c \
+    $$LIBXCB_DIR/present.c
 
 #
 # xcb-util